@@ -4,25 +4,64 @@
 #
 #-------------------------------------------------
 
-QT       += core gui opengl widgets
+QT       += core gui opengl widgets concurrent network
 
 TARGET = GlGraph
 TEMPLATE = app
+CONFIG   += c++11
 
 SOURCES += main.cpp\
         mainwindow.cpp \
-        glgraphwidget.cpp
+        glgraphwidget.cpp \
+        glgraphresources.cpp \
+        graphkernels.cpp \
+        densitymap.cpp \
+        fftplan.cpp \
+        spectrumanalyzer.cpp \
+        qualitycontroller.cpp \
+        glgraphrenderthread.cpp \
+        glgraphsurface.cpp \
+        framepool.cpp \
+        samplehistory.cpp \
+        linerasterizer.cpp \
+        graphdatasource.cpp \
+        socketdatasource.cpp \
+        sharedmemorydatasource.cpp \
+        alarmindex.cpp
 
 HEADERS  += mainwindow.h \
-         glgraphwidget.h
+         glgraphwidget.h \
+         glgraphresources.h \
+         graphkernels.h \
+         densitymap.h \
+         fftplan.h \
+         spectrumanalyzer.h \
+         qualitycontroller.h \
+         glgraphrenderthread.h \
+         glgraphsurface.h \
+         triplebuffer.h \
+         framepool.h \
+         samplehistory.h \
+         linerasterizer.h \
+         graphdataprotocol.h \
+         graphdatasource.h \
+         socketdatasource.h \
+         sharedmemorydatasource.h \
+         alarmindex.h
 
 FORMS    += mainwindow.ui
 
+unix:!macx: LIBS += -lrt
+
 OTHER_FILES += \
     graphshader.vert \
     graphshader.frag \
     gridshader.vert \
-    gridshader.frag
+    gridshader.frag \
+    densityshader.vert \
+    densityshader.frag \
+    alarmshader.vert \
+    alarmshader.frag
 
 RESOURCES += \
     Shaders.qrc
@@ -0,0 +1,125 @@
+#include "alarmindex.h"
+#include "graphkernels.h"
+
+AlarmIndex::AlarmIndex()
+    : m_fLow(1)
+    , m_fHigh(0)
+    , m_bOutside(false)
+    , m_iPosition(0)
+    , m_iFirstEvent(0)
+{
+}
+
+void AlarmIndex::setLimits(float low, float high)
+{
+    m_fLow = low;
+    m_fHigh = high;
+    clear();
+}
+
+bool AlarmIndex::isEnabled() const
+{
+    return m_fLow <= m_fHigh;
+}
+
+float AlarmIndex::lowLimit() const
+{
+    return m_fLow;
+}
+
+float AlarmIndex::highLimit() const
+{
+    return m_fHigh;
+}
+
+void AlarmIndex::clear()
+{
+    m_events.clear();
+    m_iFirstEvent = 0;
+    m_bOutside = false;
+}
+
+void AlarmIndex::append(const float *data, int count)
+{
+    if(!isEnabled() || count <= 0)
+    {
+        m_iPosition += qMax(0, count);
+        return;
+    }
+
+    if(m_edges.size() < count)
+        m_edges.resize(count);
+
+    //Edges alternate between leaving and re-entering the limits
+    bool outside = m_bOutside;
+    int edges = FindExcursions(data, count, m_fLow, m_fHigh, outside, m_edges.data());
+    for(int i = 0; i < edges; i++)
+    {
+        qint64 edge = m_iPosition + m_edges[i];
+        if(m_bOutside)
+        {
+            m_events.last().end = edge;
+        }
+        else
+        {
+            Event event;
+            event.start = edge;
+            event.end = edge;
+            m_events.append(event);
+        }
+
+        m_bOutside = !m_bOutside;
+    }
+
+    m_iPosition += count;
+    if(m_bOutside)
+        m_events.last().end = m_iPosition;
+}
+
+qint64 AlarmIndex::position() const
+{
+    return m_iPosition;
+}
+
+void AlarmIndex::discardBefore(qint64 position)
+{
+    int last = m_events.size() - (m_bOutside ? 1 : 0);
+    while(m_iFirstEvent < last && m_events[m_iFirstEvent].end <= position)
+        m_iFirstEvent++;
+
+    //Removed in bulk so discarding stays constant time per event
+    if(m_iFirstEvent > 0 && m_iFirstEvent >= m_events.size() / 2)
+    {
+        m_events.remove(0, m_iFirstEvent);
+        m_iFirstEvent = 0;
+    }
+}
+
+int AlarmIndex::eventCount() const
+{
+    return m_events.size() - m_iFirstEvent;
+}
+
+void AlarmIndex::events(qint64 origin, qint64 first, qint64 last, QVector<float> &spans) const
+{
+    if(first >= last)
+        return;
+
+    //Events do not overlap, so their ends are sorted as well
+    int low = m_iFirstEvent;
+    int high = m_events.size();
+    while(low < high)
+    {
+        int middle = (low + high) / 2;
+        if(m_events[middle].end <= origin + first)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    for(int i = low; i < m_events.size() && m_events[i].start < origin + last; i++)
+    {
+        spans.append(qMax(m_events[i].start - origin, first));
+        spans.append(qMin(m_events[i].end - origin, last));
+    }
+}
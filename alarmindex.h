@@ -0,0 +1,51 @@
+#ifndef ALARMINDEX_H
+#define ALARMINDEX_H
+
+#include <QVector>
+
+//Runs of samples outside a pair of limits, found while the samples are
+//ingested. Samples are numbered from the first one appended; every event is
+//a [start, end) range of those positions and events are kept in order, so the
+//ones in view are found with a binary search and never a pass over the data.
+class AlarmIndex
+{
+public:
+    AlarmIndex();
+
+    //Samples below low or above high raise an alarm, low > high turns
+    //detection off. Clears the index.
+    void setLimits(float low, float high);
+    bool isEnabled() const;
+    float lowLimit() const;
+    float highLimit() const;
+    void clear();
+
+    //Only looks at the new samples
+    void append(const float *data, int count);
+    //Position the next sample appended will get
+    qint64 position() const;
+    //Forgets the events that end before position
+    void discardBefore(qint64 position);
+    int eventCount() const;
+
+    //Appends a start, end pair per event overlapping [first, last) to spans,
+    //clipped to that range. Positions are relative to origin.
+    void events(qint64 origin, qint64 first, qint64 last, QVector<float> &spans) const;
+
+private:
+    struct Event
+    {
+        qint64 start;
+        qint64 end;
+    };
+
+    float m_fLow;
+    float m_fHigh;
+    bool m_bOutside;        //The last event is still open
+    qint64 m_iPosition;
+    QVector<Event> m_events;
+    int m_iFirstEvent;      //Events before this one are discarded
+    QVector<int> m_edges;
+};
+
+#endif // ALARMINDEX_H
@@ -0,0 +1,6 @@
+uniform vec4 alarmColor;
+
+void main(void)
+{
+    gl_FragColor = alarmColor;
+}
@@ -0,0 +1,640 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+#include <qnumeric.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "graphkernels.h"
+#include "samplehistory.h"
+#include "alarmindex.h"
+#include "math.h"
+
+//Times the per-sample kernels of the graph data path over several data sizes
+//and shapes, and checks their output against known answers. Prints JSON:
+//
+//  kernelbench [--output file] [--quick]
+//
+//Exits with 1 if any check failed, so it can guard kernel changes.
+
+#define MIN_RUN_TIME_NS 20000000
+#define RUNS 5
+#define COLUMNS 1024
+#define ROWS 512
+
+namespace
+{
+    //The kernels only take floats, so "sample types" are shapes of data that
+    //take different paths through them
+    enum Shape
+    {
+        Noise,
+        Ramp,           //Every sample a new maximum
+        AllNegative,
+        LargeMagnitude, //Close to the limits of float
+        Spikes          //Quiet with rare excursions, the alarm case
+    };
+
+    const char *shapeName(Shape shape)
+    {
+        switch(shape)
+        {
+        case Noise: return "noise";
+        case Ramp: return "ramp";
+        case AllNegative: return "allNegative";
+        case LargeMagnitude: return "largeMagnitude";
+        case Spikes: return "spikes";
+        }
+
+        return "";
+    }
+
+    struct Result
+    {
+        QString kernel;
+        QString shape;
+        int samples;
+        qint64 iterations;
+        double nsPerCall;
+    };
+
+    struct Check
+    {
+        QString name;
+        bool passed;
+        QString detail;
+    };
+
+    QVector<Result> s_results;
+    QVector<Check> s_checks;
+
+    //Written by every benchmark so the work cannot be optimized away
+    volatile float s_sink;
+
+    float randomValue(float min, float max)
+    {
+        return min + ((max - min) * ((float)rand() / (float)RAND_MAX));
+    }
+
+    QVector<float> makeData(Shape shape, int count)
+    {
+        QVector<float> data(count);
+        srand(count);
+
+        for(int i = 0; i < count; i++)
+        {
+            switch(shape)
+            {
+            case Noise:
+                data[i] = randomValue(-1, 1);
+                break;
+            case Ramp:
+                data[i] = (float)i / count;
+                break;
+            case AllNegative:
+                data[i] = randomValue(-1000, -1);
+                break;
+            case LargeMagnitude:
+                data[i] = randomValue(-3e38f, 3e38f);
+                break;
+            case Spikes:
+                data[i] = (rand() % 4096 == 0) ? 10 : randomValue(-1, 1);
+                break;
+            }
+        }
+
+        return data;
+    }
+
+    template <typename Function>
+    void benchmark(const QString &kernel, Shape shape, int samples, Function function)
+    {
+        //Enough iterations to run for a while, best of several runs
+        qint64 iterations = 1;
+        QElapsedTimer timer;
+        for(;;)
+        {
+            timer.start();
+            for(qint64 i = 0; i < iterations; i++)
+                function();
+
+            if(timer.nsecsElapsed() >= MIN_RUN_TIME_NS)
+                break;
+            iterations *= 2;
+        }
+
+        double best = timer.nsecsElapsed();
+        for(int run = 1; run < RUNS; run++)
+        {
+            timer.start();
+            for(qint64 i = 0; i < iterations; i++)
+                function();
+            best = qMin(best, (double)timer.nsecsElapsed());
+        }
+
+        Result result;
+        result.kernel = kernel;
+        result.shape = shapeName(shape);
+        result.samples = samples;
+        result.iterations = iterations;
+        result.nsPerCall = best / iterations;
+        s_results.append(result);
+
+        fprintf(stderr, "%-16s %-15s %9d %12.1f ns\n", kernel.toLatin1().constData(),
+                shapeName(shape), samples, result.nsPerCall);
+    }
+
+    void check(const QString &name, bool passed, const QString &detail = QString())
+    {
+        Check result;
+        result.name = name;
+        result.passed = passed;
+        result.detail = detail;
+        s_checks.append(result);
+
+        if(!passed)
+            fprintf(stderr, "FAILED %s %s\n", name.toLatin1().constData(), detail.toLatin1().constData());
+    }
+
+    bool nearlyEqual(float value, float expected, float tolerance)
+    {
+        return fabs(value - expected) <= tolerance;
+    }
+
+    //Benchmark bodies, one functor per kernel so the timing loop can inline them
+    struct ExtentsRun
+    {
+        const QVector<float> *data;
+        void operator()() const
+        {
+            float min, max;
+            FindExtents(data->constData(), data->size(), min, max);
+            s_sink = min + max;
+        }
+    };
+
+    struct XAxisRun
+    {
+        QVector<float> *x;
+        void operator()() const
+        {
+            FillXAxis(x->data(), x->size());
+            s_sink = x->last();
+        }
+    };
+
+    struct AutoScaleRun
+    {
+        const QVector<float> *data;
+        void operator()() const
+        {
+            //Pairs of neighbouring samples as limits, the cost is per call
+            float sum = 0;
+            const float *values = data->constData();
+            for(int i = 0; i + 1 < data->size(); i += 2)
+                sum += YAxisScale(values[i], values[i + 1]) + YAxisOffset(values[i], values[i + 1]);
+            s_sink = sum;
+        }
+    };
+
+    struct DecimateRun
+    {
+        const QVector<float> *data;
+        QVector<float> *x;
+        QVector<float> *y;
+        void operator()() const
+        {
+            s_sink = DecimateMinMax(data->constData(), data->size(), COLUMNS, x->data(), y->data());
+        }
+    };
+
+    struct LineSpansRun
+    {
+        const QVector<float> *data;
+        float yScale;
+        float yOffset;
+        QVector<float> *lo;
+        QVector<float> *hi;
+        void operator()() const
+        {
+            LineSpans(data->constData(), data->size(), (float)COLUMNS / data->size(), 0,
+                      yScale, yOffset, COLUMNS, lo->data(), hi->data());
+            s_sink = (*lo)[0];
+        }
+    };
+
+    struct FillSpansRun
+    {
+        const QVector<int> *top;
+        const QVector<int> *bottom;
+        QVector<unsigned int> *pixels;
+        void operator()() const
+        {
+            FillSpans(top->constData(), bottom->constData(), COLUMNS, 0, ROWS, 0xffff0000, pixels->data(), COLUMNS);
+            s_sink = (*pixels)[0];
+        }
+    };
+
+    struct BinPointsRun
+    {
+        const QVector<float> *data;
+        float yScale;
+        float yOffset;
+        QVector<unsigned int> *bins;
+        void operator()() const
+        {
+            BinPoints(0, data->constData(), data->size(), (float)COLUMNS / data->size(), 0,
+                      yScale, yOffset, COLUMNS, ROWS, bins->data());
+            s_sink = (*bins)[0];
+        }
+    };
+
+    struct HistoryAppendRun
+    {
+        const QVector<float> *data;
+        SampleHistory *history;
+        void operator()() const
+        {
+            history->append(data->constData(), data->size());
+            s_sink = history->size();
+        }
+    };
+
+    struct HistoryDecodeRun
+    {
+        const SampleHistory *history;
+        QVector<float> *out;
+        void operator()() const
+        {
+            s_sink = history->decode(0, history->blockCount(), out->data());
+        }
+    };
+
+    struct ExcursionsRun
+    {
+        const QVector<float> *data;
+        QVector<int> *edges;
+        void operator()() const
+        {
+            bool outside = false;
+            s_sink = FindExcursions(data->constData(), data->size(), -2, 2, outside, edges->data());
+        }
+    };
+
+    struct AxisTicksRun
+    {
+        float min;
+        float max;
+        void operator()() const
+        {
+            //What every frame does, one call per axis
+            float first, step, firstPixel, pixelStep;
+            int count;
+            AxisTicks(0, COLUMNS, 10, 0, COLUMNS, first, step, count, firstPixel, pixelStep);
+            s_sink = firstPixel + count;
+            AxisTicks(min, max, 10, 0, ROWS, first, step, count, firstPixel, pixelStep);
+            s_sink += firstPixel + count;
+        }
+    };
+
+    //Same mapping the graph shader uses, data range -> [-1, 1]
+    void yTransform(const QVector<float> &data, float &scale, float &offset)
+    {
+        float min, max;
+        FindExtents(data.constData(), data.size(), min, max);
+        scale = YAxisScale(min, max) * (ROWS / 2);
+        offset = (YAxisOffset(min, max) + 1) * (ROWS / 2);
+    }
+
+    void runBenchmarks(const QVector<int> &sizes)
+    {
+        const Shape shapes[] = { Noise, Ramp, AllNegative, LargeMagnitude, Spikes };
+        const int shapeCount = sizeof(shapes) / sizeof(shapes[0]);
+
+        QVector<float> decimatedX(2 * COLUMNS), decimatedY(2 * COLUMNS);
+        QVector<float> lo(COLUMNS), hi(COLUMNS);
+        QVector<unsigned int> bins(COLUMNS * ROWS);
+
+        for(int s = 0; s < sizes.size(); s++)
+        {
+            int size = sizes[s];
+
+            QVector<float> x(size);
+            XAxisRun xAxis = { &x };
+            benchmark("FillXAxis", Ramp, size, xAxis);
+
+            for(int i = 0; i < shapeCount; i++)
+            {
+                Shape shape = shapes[i];
+                QVector<float> data = makeData(shape, size);
+                float yScale, yOffset;
+                yTransform(data, yScale, yOffset);
+
+                ExtentsRun extents = { &data };
+                benchmark("FindExtents", shape, size, extents);
+
+                AutoScaleRun autoScale = { &data };
+                benchmark("YAxisTransform", shape, size, autoScale);
+
+                DecimateRun decimate = { &data, &decimatedX, &decimatedY };
+                benchmark("DecimateMinMax", shape, size, decimate);
+
+                LineSpansRun lineSpans = { &data, yScale, yOffset, &lo, &hi };
+                benchmark("LineSpans", shape, size, lineSpans);
+
+                BinPointsRun binPoints = { &data, yScale, yOffset, &bins };
+                benchmark("BinPoints", shape, size, binPoints);
+
+                QVector<int> edges(size);
+                ExcursionsRun excursions = { &data, &edges };
+                benchmark("FindExcursions", shape, size, excursions);
+
+                //A history that wraps, so appending also drops the oldest blocks
+                SampleHistory history;
+                history.setCapacity(size * 4);
+                HistoryAppendRun append = { &data, &history };
+                benchmark("HistoryAppend", shape, size, append);
+
+                QVector<float> decoded(history.blockCount() * history.blockSize());
+                HistoryDecodeRun decode = { &history, &decoded };
+                benchmark("HistoryDecode", shape, history.size(), decode);
+            }
+        }
+
+        //Per frame rather than per sample, the limits come from each shape
+        for(int i = 0; i < shapeCount; i++)
+        {
+            QVector<float> data = makeData(shapes[i], 4096);
+            AxisTicksRun ticks;
+            FindExtents(data.constData(), data.size(), ticks.min, ticks.max);
+            benchmark("AxisTicks", shapes[i], 1, ticks);
+        }
+
+        //Fill cost only depends on the image size
+        QVector<int> top(COLUMNS), bottom(COLUMNS);
+        for(int i = 0; i < COLUMNS; i++)
+        {
+            top[i] = (i * 7) % ROWS;
+            bottom[i] = qMin(ROWS - 1, top[i] + (i % 64));
+        }
+        QVector<unsigned int> pixels(COLUMNS * ROWS);
+        FillSpansRun fillSpans = { &top, &bottom, &pixels };
+        benchmark("FillSpans", Noise, COLUMNS * ROWS, fillSpans);
+    }
+
+    void runChecks()
+    {
+        float min, max;
+
+        //Extents, including data that never reaches zero
+        const float negative[] = { -5, -2.5f, -7, -1 };
+        FindExtents(negative, 4, min, max);
+        check("FindExtents.allNegative", min == -7 && max == -1,
+              QString("min %1 max %2").arg(min).arg(max));
+
+        const float large[] = { 1e38f, -3.4e38f, 3.4e38f, -1e38f };
+        FindExtents(large, 4, min, max);
+        check("FindExtents.largeMagnitude", min == -3.4e38f && max == 3.4e38f,
+              QString("min %1 max %2").arg(min).arg(max));
+
+        const float tiny[] = { FLT_MIN, FLT_MIN * 4, FLT_MIN * 2 };
+        FindExtents(tiny, 3, min, max);
+        check("FindExtents.tiny", min == FLT_MIN && max == FLT_MIN * 4);
+
+        const float nanFirst[] = { NAN, 3, -2, NAN, 5 };
+        FindExtents(nanFirst, 5, min, max);
+        check("FindExtents.nanFirst", min == -2 && max == 5, QString("min %1 max %2").arg(min).arg(max));
+
+        const float allNan[] = { NAN, NAN };
+        FindExtents(allNan, 2, min, max);
+        check("FindExtents.allNan", min == 0 && max == 0, QString("min %1 max %2").arg(min).arg(max));
+
+        const float single[] = { 42 };
+        FindExtents(single, 1, min, max);
+        check("FindExtents.single", min == 42 && max == 42);
+
+        //The Y transform must put the extents on the edges of the plot
+        const float limits[][2] = { { -7, -1 }, { 0, 1 }, { -1, 1 }, { 1000, 1001 }, { -3.4e38f, 3.4e38f } };
+        for(unsigned int i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+        {
+            float scale = YAxisScale(limits[i][0], limits[i][1]);
+            float offset = YAxisOffset(limits[i][0], limits[i][1]);
+            float bottom = ((double)limits[i][0] * scale) + offset;
+            float top = ((double)limits[i][1] * scale) + offset;
+            check(QString("YAxisTransform.%1_%2").arg(limits[i][0]).arg(limits[i][1]),
+                  nearlyEqual(bottom, -1, 1e-3f) && nearlyEqual(top, 1, 1e-3f),
+                  QString("maps to %1 %2").arg(bottom).arg(top));
+
+            //The shader's version, in float with neither factor subnormal
+            float first, second;
+            YAxisScaleFactors(limits[i][0], limits[i][1], first, second);
+            bottom = ((limits[i][0] * first) * second) + offset;
+            top = ((limits[i][1] * first) * second) + offset;
+            check(QString("YAxisScaleFactors.%1_%2").arg(limits[i][0]).arg(limits[i][1]),
+                  first >= FLT_MIN && second >= FLT_MIN && nearlyEqual(bottom, -1, 1e-3f) && nearlyEqual(top, 1, 1e-3f),
+                  QString("factors %1 %2 map to %3 %4").arg(first).arg(second).arg(bottom).arg(top));
+        }
+
+        //Equal limits, a flat line, must still give a finite transform
+        float flatScale = YAxisScale(0.5f, 0.5f);
+        float flatOffset = YAxisOffset(0.5f, 0.5f);
+        float flatValue = (0.5f * flatScale) + flatOffset;
+        check("YAxisTransform.equal", qIsFinite(flatScale) && qIsFinite(flatOffset) && nearlyEqual(flatValue, 0, 1e-6f),
+              QString("scale %1 offset %2 maps to %3").arg(flatScale).arg(flatOffset).arg(flatValue));
+
+        //Tick steps, a 1, 2 or 5 times power of ten step and none for an
+        //empty or reversed span
+        struct StepCase { double range; int divisions; float expected; };
+        const StepCase steps[] = {
+            { 10, 10, 1 }, { 1, 5, 0.2f }, { 6, 10, 0.5f }, { 7.5, 10, 1 }, { 0.002, 10, 0.0002f },
+            { 1e-30, 10, 1e-31f }, { 6.8e38, 10, 5e37f }, { 0, 10, 0 }, { -6, 10, 0 }, { 10, 0, 0 } };
+        for(unsigned int i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+        {
+            float step = NiceStep(steps[i].range, steps[i].divisions);
+            check(QString("NiceStep.%1_%2").arg(steps[i].range).arg(steps[i].divisions),
+                  fabs(step - steps[i].expected) <= fabs(steps[i].expected) * 1e-5f,
+                  QString("step %1").arg(step));
+        }
+        check("NiceStep.nan", NiceStep(NAN, 10) == 0);
+
+        //Ticks on negative limits land on multiples of the step, and the whole
+        //float range still gives finite ticks
+        float first, step, firstPixel, pixelStep;
+        int count;
+        AxisTicks(-7, -1, 10, 0, 600, first, step, count, firstPixel, pixelStep);
+        check("AxisTicks.negative", step == 0.5f && first == -7 && count == 13 &&
+              nearlyEqual(firstPixel, 0, 1e-3f) && nearlyEqual(pixelStep, 50, 1e-3f),
+              QString("first %1 step %2 count %3 at %4 + %5").arg(first).arg(step).arg(count).arg(firstPixel).arg(pixelStep));
+        AxisTicks(-3.4e38f, 3.4e38f, 10, 0, 600, first, step, count, firstPixel, pixelStep);
+        check("AxisTicks.fullRange", step == 5e37f && count == 13 && qIsFinite(firstPixel) && qIsFinite(pixelStep),
+              QString("first %1 step %2 count %3 at %4 + %5").arg(first).arg(step).arg(count).arg(firstPixel).arg(pixelStep));
+        AxisTicks(3, 3, 10, 0, 600, first, step, count, firstPixel, pixelStep);
+        check("AxisTicks.zeroSpan", count == 0);
+
+        //X axis spacing
+        QVector<float> x(1000);
+        FillXAxis(x.data(), x.size());
+        check("FillXAxis.ends", nearlyEqual(x[0], -1 + 0.002f, 1e-6f) && nearlyEqual(x.last(), 1, 1e-4f),
+              QString("first %1 last %2").arg(x[0]).arg(x.last()));
+
+        //Decimation keeps the extremes, even a single sample spike
+        QVector<float> data = makeData(Noise, 100000);
+        data[12345] = 50;
+        data[67890] = -50;
+        QVector<float> decimatedX(2 * COLUMNS), decimatedY(2 * COLUMNS);
+        int points = DecimateMinMax(data.constData(), data.size(), COLUMNS, decimatedX.data(), decimatedY.data());
+        FindExtents(decimatedY.constData(), points, min, max);
+        check("DecimateMinMax.keepsSpikes", points <= 2 * COLUMNS && min == -50 && max == 50);
+
+        //A flat line covers a single row in every column
+        QVector<float> flat(5000, 0.5f);
+        QVector<float> lo(COLUMNS), hi(COLUMNS);
+        LineSpans(flat.constData(), flat.size(), (float)COLUMNS / flat.size(), 0, 100, 0, COLUMNS, lo.data(), hi.data());
+        bool flatSpans = true;
+        for(int i = 0; i < COLUMNS; i++)
+            flatSpans &= (lo[i] == 50 && hi[i] == 50);
+        check("LineSpans.flat", flatSpans);
+
+        //Every point in range lands in exactly one bin
+        QVector<unsigned int> bins(COLUMNS * ROWS);
+        float yScale, yOffset;
+        yTransform(data, yScale, yOffset);
+        BinPoints(0, data.constData(), data.size(), (float)COLUMNS / data.size(), 0,
+                  yScale * 0.99f, yOffset, COLUMNS, ROWS, bins.data());
+        qint64 binned = 0;
+        for(int i = 0; i < bins.size(); i++)
+            binned += bins[i];
+        check("BinPoints.count", binned == data.size(), QString("binned %1").arg(binned));
+
+        //The history is lossless, including values at the limits of float
+        const Shape historyShapes[] = { Noise, AllNegative, LargeMagnitude, Spikes };
+        for(unsigned int i = 0; i < sizeof(historyShapes) / sizeof(historyShapes[0]); i++)
+        {
+            QVector<float> samples = makeData(historyShapes[i], 10000);
+            SampleHistory history;
+            history.setCapacity(samples.size());
+            history.append(samples.constData(), samples.size());
+
+            QVector<float> decoded(history.blockCount() * history.blockSize());
+            int count = history.decode(0, history.blockCount(), decoded.data());
+            check(QString("SampleHistory.roundTrip.%1").arg(shapeName(historyShapes[i])),
+                  count == samples.size() && memcmp(decoded.constData(), samples.constData(), count * sizeof(float)) == 0);
+        }
+
+        //Excursions match a plain scan, across block boundaries and in a
+        //stream split into blocks
+        QVector<float> spikes = makeData(Spikes, 100000);
+        spikes[63] = 10;
+        spikes[64] = 10;
+        spikes[99999] = -10;
+        QVector<int> edges(spikes.size());
+        bool outside = false;
+        int edgeCount = FindExcursions(spikes.constData(), spikes.size(), -2, 2, outside, edges.data());
+
+        QVector<int> expected;
+        int state = 0;
+        for(int i = 0; i < spikes.size(); i++)
+        {
+            int value = (spikes[i] < -2 || spikes[i] > 2) ? 1 : 0;
+            if(value != state)
+                expected.append(i);
+            state = value;
+        }
+        edges.resize(edgeCount);
+        check("FindExcursions.matchesScan", edges == expected && outside,
+              QString("%1 edges, expected %2").arg(edgeCount).arg(expected.size()));
+
+        AlarmIndex alarms;
+        alarms.setLimits(-2, 2);
+        for(int i = 0; i < spikes.size(); i += 1000)
+            alarms.append(spikes.constData() + i, qMin(1000, spikes.size() - i));
+        check("AlarmIndex.events", alarms.eventCount() == (expected.size() + 1) / 2,
+              QString("%1 events").arg(alarms.eventCount()));
+    }
+
+    QString toJson()
+    {
+        QString json;
+        QTextStream out(&json);
+        out.setRealNumberPrecision(6);
+
+        bool passed = true;
+        for(int i = 0; i < s_checks.size(); i++)
+            passed &= s_checks[i].passed;
+
+        out << "{\n  \"benchmarks\": [";
+        for(int i = 0; i < s_results.size(); i++)
+        {
+            const Result &result = s_results[i];
+            out << (i ? "," : "") << "\n    { \"kernel\": \"" << result.kernel
+                << "\", \"shape\": \"" << result.shape
+                << "\", \"samples\": " << result.samples
+                << ", \"iterations\": " << result.iterations
+                << ", \"nsPerCall\": " << result.nsPerCall
+                << ", \"nsPerSample\": " << (result.nsPerCall / qMax(1, result.samples)) << " }";
+        }
+
+        out << "\n  ],\n  \"checks\": [";
+        for(int i = 0; i < s_checks.size(); i++)
+        {
+            const Check &result = s_checks[i];
+            QString detail = result.detail;
+            detail.replace('\\', "\\\\").replace('"', "\\\"");
+            out << (i ? "," : "") << "\n    { \"name\": \"" << result.name
+                << "\", \"passed\": " << (result.passed ? "true" : "false")
+                << ", \"detail\": \"" << detail << "\" }";
+        }
+
+        out << "\n  ],\n  \"passed\": " << (passed ? "true" : "false") << "\n}\n";
+        out.flush();
+        return json;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    QString outputFile;
+    int index = args.indexOf("--output");
+    if(index >= 0 && index + 1 < args.size())
+        outputFile = args[index + 1];
+
+    QVector<int> sizes;
+    if(args.contains("--quick"))
+        sizes << 4096;
+    else
+        sizes << 4096 << 65536 << 1048576;
+
+    runChecks();
+    runBenchmarks(sizes);
+
+    QString json = toJson();
+    if(outputFile.isEmpty())
+    {
+        fputs(json.toUtf8().constData(), stdout);
+    }
+    else
+    {
+        QFile file(outputFile);
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            fprintf(stderr, "Could not write %s\n", outputFile.toLocal8Bit().constData());
+            return 2;
+        }
+        file.write(json.toUtf8());
+    }
+
+    for(int i = 0; i < s_checks.size(); i++)
+    {
+        if(!s_checks[i].passed)
+            return 1;
+    }
+
+    return 0;
+}
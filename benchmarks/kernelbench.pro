@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Micro-benchmarks and golden output checks for the per-sample kernels.
+# Built on its own: qmake benchmarks/kernelbench.pro && make
+#
+#-------------------------------------------------
+
+QT       += core concurrent
+QT       -= gui
+
+TARGET = kernelbench
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += kernelbench.cpp \
+        ../graphkernels.cpp \
+        ../samplehistory.cpp \
+        ../alarmindex.cpp
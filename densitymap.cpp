@@ -0,0 +1,185 @@
+#include "densitymap.h"
+#include "graphkernels.h"
+#include <QColor>
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrentRun>
+#include "math.h"
+
+#define COLOR_TABLE_SIZE 256
+#define MIN_POINTS_PER_THREAD 65536
+
+namespace
+{
+    struct BinChunk
+    {
+        const float *x;
+        const float *y;
+        int count;
+        float xScale;
+        float xOffset;
+        float yScale;
+        float yOffset;
+        int width;
+        int height;
+        unsigned int *bins;
+    };
+
+    void BinChunkPoints(BinChunk *chunk)
+    {
+        BinPoints(chunk->x, chunk->y, chunk->count,
+                  chunk->xScale, chunk->xOffset, chunk->yScale, chunk->yOffset,
+                  chunk->width, chunk->height, chunk->bins);
+    }
+}
+
+DensityMap::DensityMap()
+{
+    QGradientStops stops;
+    stops << QGradientStop(0.0, QColor::fromRgb(0,0,128));
+    stops << QGradientStop(0.35, QColor::fromRgb(0,160,255));
+    stops << QGradientStop(0.65, QColor::fromRgb(255,255,0));
+    stops << QGradientStop(1.0, QColor::fromRgb(255,0,0));
+    setColorMap(stops);
+}
+
+void DensityMap::setColorMap(const QGradientStops &stops)
+{
+    m_colorTable.resize(COLOR_TABLE_SIZE);
+
+    if(stops.isEmpty())
+    {
+        m_colorTable.fill(qRgb(255,255,255));
+        return;
+    }
+
+    int stop = 0;
+    for(int i = 0; i < COLOR_TABLE_SIZE; i++)
+    {
+        qreal pos = (qreal)i / (COLOR_TABLE_SIZE - 1);
+        while(stop < stops.size() - 1 && stops[stop + 1].first < pos)
+            stop++;
+
+        const QGradientStop &low = stops[stop];
+        const QGradientStop &high = stops[qMin(stop + 1, stops.size() - 1)];
+
+        qreal t = 0;
+        if(high.first > low.first)
+            t = qBound((qreal)0, (pos - low.first) / (high.first - low.first), (qreal)1);
+
+        m_colorTable[i] = qRgb(low.second.red() + (high.second.red() - low.second.red()) * t,
+                               low.second.green() + (high.second.green() - low.second.green()) * t,
+                               low.second.blue() + (high.second.blue() - low.second.blue()) * t);
+    }
+}
+
+void DensityMap::build(const float *x, const float *y, int count,
+                       float xScale, float xOffset, float yScale, float yOffset,
+                       const QSize &size)
+{
+    m_size = size;
+    m_bins.resize(size.width() * size.height());
+    m_bins.fill(0);
+
+    if(count > 0 && !m_bins.isEmpty())
+        binParallel(x, y, count, xScale, xOffset, yScale, yOffset);
+
+    colorize();
+}
+
+QSize DensityMap::size() const
+{
+    return m_size;
+}
+
+const uchar *DensityMap::pixels() const
+{
+    return m_pixels.constData();
+}
+
+void DensityMap::binParallel(const float *x, const float *y, int count,
+                             float xScale, float xOffset, float yScale, float yOffset)
+{
+    int threads = qBound(1, count / MIN_POINTS_PER_THREAD, QThread::idealThreadCount());
+    int chunkSize = (count + threads - 1) / threads;
+
+    //Every thread bins into its own histogram, the first one uses the result.
+    //The partial histograms are kept between builds to avoid reallocating them.
+    QVector<QVector<unsigned int> > &partials = m_partials;
+    partials.resize(threads - 1);
+    QVector<BinChunk> chunks(threads);
+    for(int i = 0; i < threads; i++)
+    {
+        int start = i * chunkSize;
+
+        BinChunk &chunk = chunks[i];
+        chunk.x = x ? x + start : 0;
+        chunk.y = y + start;
+        chunk.count = qMin(chunkSize, count - start);
+        chunk.xScale = xScale;
+        //Index based x values restart at zero for every chunk
+        chunk.xOffset = x ? xOffset : xOffset + (start * xScale);
+        chunk.yScale = yScale;
+        chunk.yOffset = yOffset;
+        chunk.width = m_size.width();
+        chunk.height = m_size.height();
+
+        if(i == 0)
+        {
+            chunk.bins = m_bins.data();
+        }
+        else
+        {
+            partials[i - 1].fill(0, m_bins.size());
+            chunk.bins = partials[i - 1].data();
+        }
+    }
+
+    QVector<QFuture<void> > futures;
+    for(int i = 1; i < threads; i++)
+        futures.append(QtConcurrent::run(BinChunkPoints, &chunks[i]));
+
+    BinChunkPoints(&chunks[0]);
+
+    for(int i = 0; i < futures.size(); i++)
+        futures[i].waitForFinished();
+
+    unsigned int *bins = m_bins.data();
+    for(int i = 0; i < partials.size(); i++)
+    {
+        const unsigned int *partial = partials[i].constData();
+        for(int j = 0; j < m_bins.size(); j++)
+            bins[j] += partial[j];
+    }
+}
+
+void DensityMap::colorize()
+{
+    m_pixels.resize(m_bins.size() * 4);
+
+    unsigned int maxCount = 0;
+    for(int i = 0; i < m_bins.size(); i++)
+        maxCount = qMax(maxCount, m_bins[i]);
+
+    //Log scale so single hits are still visible next to dense regions
+    float scale = 0;
+    if(maxCount > 0)
+        scale = (COLOR_TABLE_SIZE - 1) / log((float)maxCount + 1);
+
+    uchar *pixel = m_pixels.data();
+    for(int i = 0; i < m_bins.size(); i++, pixel += 4)
+    {
+        unsigned int hits = m_bins[i];
+        if(hits == 0)
+        {
+            pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+            continue;
+        }
+
+        QRgb color = m_colorTable[qBound(0, (int)(log((float)hits + 1) * scale), COLOR_TABLE_SIZE - 1)];
+        pixel[0] = qRed(color);
+        pixel[1] = qGreen(color);
+        pixel[2] = qBlue(color);
+        pixel[3] = 255;
+    }
+}
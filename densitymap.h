@@ -0,0 +1,41 @@
+#ifndef DENSITYMAP_H
+#define DENSITYMAP_H
+
+#include <QVector>
+#include <QSize>
+#include <QRgb>
+#include <QGradientStops>
+
+//Bins scatter points into a per-pixel hit count and colours it through a
+//lookup table, so drawing millions of points costs a texture upload that only
+//depends on the size of the plot.
+class DensityMap
+{
+public:
+    DensityMap();
+
+    void setColorMap(const QGradientStops &stops);
+
+    //Maps each point with (x * xScale + xOffset, y * yScale + yOffset) into a
+    //size.width() x size.height() map. If x is null the sample index is used.
+    void build(const float *x, const float *y, int count,
+               float xScale, float xOffset, float yScale, float yOffset,
+               const QSize &size);
+
+    QSize size() const;
+    //RGBA, one byte per channel, bottom row first (GL texture order)
+    const uchar *pixels() const;
+
+private:
+    void binParallel(const float *x, const float *y, int count,
+                     float xScale, float xOffset, float yScale, float yOffset);
+    void colorize();
+
+    QVector<QRgb> m_colorTable;
+    QVector<unsigned int> m_bins;
+    QVector<QVector<unsigned int> > m_partials;
+    QVector<uchar> m_pixels;
+    QSize m_size;
+};
+
+#endif // DENSITYMAP_H
@@ -0,0 +1,7 @@
+uniform sampler2D densityTexture;
+varying vec2 texCoord;
+
+void main(void)
+{
+    gl_FragColor = texture2D(densityTexture, texCoord);
+}
@@ -0,0 +1,11 @@
+#version 120
+
+attribute vec2 vertex;
+uniform mat4 transform;
+varying vec2 texCoord;
+
+void main(void)
+{
+    texCoord = (vertex + 1.0) / 2.0;
+    gl_Position = transform * vec4(vertex, 0.0, 1.0);
+}
@@ -0,0 +1,99 @@
+#include "fftplan.h"
+#include <qmath.h>
+
+FftPlan::FftPlan()
+    : m_iSize(0)
+{
+}
+
+void FftPlan::setSize(int size)
+{
+    if(size == m_iSize || !isPowerOfTwo(size))
+        return;
+
+    m_iSize = size;
+
+    int bits = 0;
+    while((1 << bits) < size)
+        bits++;
+
+    m_bitReverse.resize(size);
+    for(int i = 0; i < size; i++)
+    {
+        int reversed = 0;
+        for(int bit = 0; bit < bits; bit++)
+        {
+            if(i & (1 << bit))
+                reversed |= 1 << (bits - 1 - bit);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    //Twiddles for the largest stage, smaller stages use every n-th entry
+    m_cos.resize(size / 2);
+    m_sin.resize(size / 2);
+    for(int i = 0; i < size / 2; i++)
+    {
+        double angle = (-2.0 * M_PI * i) / size;
+        m_cos[i] = cos(angle);
+        m_sin[i] = sin(angle);
+    }
+}
+
+int FftPlan::size() const
+{
+    return m_iSize;
+}
+
+void FftPlan::transform(float *re, float *im) const
+{
+    const int *bitReverse = m_bitReverse.constData();
+    for(int i = 0; i < m_iSize; i++)
+    {
+        int j = bitReverse[i];
+        if(j > i)
+        {
+            float tmp = re[i];
+            re[i] = re[j];
+            re[j] = tmp;
+
+            tmp = im[i];
+            im[i] = im[j];
+            im[j] = tmp;
+        }
+    }
+
+    const float *cosTable = m_cos.constData();
+    const float *sinTable = m_sin.constData();
+
+    for(int length = 2; length <= m_iSize; length *= 2)
+    {
+        int half = length / 2;
+        int step = m_iSize / length;
+
+        for(int start = 0; start < m_iSize; start += length)
+        {
+            for(int k = 0; k < half; k++)
+            {
+                float wr = cosTable[k * step];
+                float wi = sinTable[k * step];
+
+                int even = start + k;
+                int odd = even + half;
+
+                float tr = (re[odd] * wr) - (im[odd] * wi);
+                float ti = (re[odd] * wi) + (im[odd] * wr);
+
+                re[odd] = re[even] - tr;
+                im[odd] = im[even] - ti;
+                re[even] += tr;
+                im[even] += ti;
+            }
+        }
+    }
+}
+
+bool FftPlan::isPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
@@ -0,0 +1,30 @@
+#ifndef FFTPLAN_H
+#define FFTPLAN_H
+
+#include <QVector>
+
+//Radix-2 complex FFT. The bit reversal permutation and twiddle factors are
+//computed once in setSize() so repeated transforms of the same size do not
+//allocate or call sin/cos.
+class FftPlan
+{
+public:
+    FftPlan();
+
+    //size must be a power of two
+    void setSize(int size);
+    int size() const;
+
+    //In place forward transform of size() complex values
+    void transform(float *re, float *im) const;
+
+    static bool isPowerOfTwo(int value);
+
+private:
+    int m_iSize;
+    QVector<int> m_bitReverse;
+    QVector<float> m_cos;
+    QVector<float> m_sin;
+};
+
+#endif // FFTPLAN_H
@@ -0,0 +1,234 @@
+#include "framepool.h"
+#include <QAtomicInt>
+#include <QMutex>
+
+struct SampleFrameBlock
+{
+    QAtomicInt ref;
+    FramePoolData *pool;    //0 for standalone frames
+    float *data;
+    int capacity;
+    int size;
+};
+
+class FramePoolData
+{
+public:
+    FramePoolData(int frameCapacity, int frameCount);
+    ~FramePoolData();
+
+    SampleFrameBlock *acquire();
+    void release(SampleFrameBlock *block);
+
+    QAtomicInt ref;         //The pool itself plus every frame in use
+    QMutex mutex;
+    int frameCapacity;
+    int frameCount;
+
+    float *arena;
+    SampleFrameBlock *blocks;
+    SampleFrameBlock **freeList;
+    int freeCount;
+};
+
+FramePoolData::FramePoolData(int frameCapacity, int frameCount)
+    : ref(1)
+    , frameCapacity(qMax(0, frameCapacity))
+    , frameCount(qMax(0, frameCount))
+    , freeCount(0)
+{
+    arena = new float[(size_t)this->frameCapacity * this->frameCount];
+    blocks = new SampleFrameBlock[this->frameCount];
+    freeList = new SampleFrameBlock *[this->frameCount];
+
+    for(int i = 0; i < this->frameCount; i++)
+    {
+        SampleFrameBlock *block = &blocks[i];
+        block->pool = this;
+        block->data = arena + ((size_t)i * this->frameCapacity);
+        block->capacity = this->frameCapacity;
+        block->size = 0;
+        freeList[freeCount++] = block;
+    }
+}
+
+FramePoolData::~FramePoolData()
+{
+    delete[] freeList;
+    delete[] blocks;
+    delete[] arena;
+}
+
+SampleFrameBlock *FramePoolData::acquire()
+{
+    QMutexLocker locker(&mutex);
+    if(freeCount == 0)
+        return 0;
+
+    SampleFrameBlock *block = freeList[--freeCount];
+    block->ref.store(1);
+    block->size = block->capacity;
+    ref.ref();
+    return block;
+}
+
+void FramePoolData::release(SampleFrameBlock *block)
+{
+    mutex.lock();
+    freeList[freeCount++] = block;
+    mutex.unlock();
+
+    //Last frame of a pool that has already been destroyed
+    if(!ref.deref())
+        delete this;
+}
+
+static void ReleaseBlock(SampleFrameBlock *block)
+{
+    if(!block || block->ref.deref())
+        return;
+
+    if(block->pool)
+    {
+        block->pool->release(block);
+    }
+    else
+    {
+        delete[] block->data;
+        delete block;
+    }
+}
+
+SampleFrame::SampleFrame()
+    : d(0)
+{
+}
+
+SampleFrame::SampleFrame(int capacity)
+    : d(new SampleFrameBlock)
+{
+    capacity = qMax(0, capacity);
+    d->ref.store(1);
+    d->pool = 0;
+    d->data = new float[capacity];
+    d->capacity = capacity;
+    d->size = capacity;
+}
+
+SampleFrame::SampleFrame(SampleFrameBlock *block)
+    : d(block)
+{
+}
+
+SampleFrame::SampleFrame(const SampleFrame &other)
+    : d(other.d)
+{
+    if(d)
+        d->ref.ref();
+}
+
+SampleFrame::~SampleFrame()
+{
+    ReleaseBlock(d);
+}
+
+SampleFrame &SampleFrame::operator=(const SampleFrame &other)
+{
+    if(other.d)
+        other.d->ref.ref();
+
+    ReleaseBlock(d);
+    d = other.d;
+    return *this;
+}
+
+bool SampleFrame::isNull() const
+{
+    return d == 0;
+}
+
+bool SampleFrame::isEmpty() const
+{
+    return !d || d->size == 0;
+}
+
+int SampleFrame::size() const
+{
+    return d ? d->size : 0;
+}
+
+int SampleFrame::capacity() const
+{
+    return d ? d->capacity : 0;
+}
+
+void SampleFrame::resize(int size)
+{
+    if(d)
+        d->size = qBound(0, size, d->capacity);
+}
+
+float *SampleFrame::data()
+{
+    return d ? d->data : 0;
+}
+
+const float *SampleFrame::data() const
+{
+    return d ? d->data : 0;
+}
+
+const float *SampleFrame::constData() const
+{
+    return d ? d->data : 0;
+}
+
+void SampleFrame::release()
+{
+    ReleaseBlock(d);
+    d = 0;
+}
+
+FramePool::FramePool(int frameCapacity, int frameCount)
+    : d(new FramePoolData(frameCapacity, frameCount))
+{
+}
+
+FramePool::~FramePool()
+{
+    if(!d->ref.deref())
+        delete d;
+}
+
+SampleFrame FramePool::acquire()
+{
+    return SampleFrame(d->acquire());
+}
+
+void FramePool::ensureCapacity(int frameCapacity)
+{
+    if(frameCapacity <= d->frameCapacity)
+        return;
+
+    FramePoolData *old = d;
+    d = new FramePoolData(frameCapacity, old->frameCount);
+
+    if(!old->ref.deref())
+        delete old;
+}
+
+int FramePool::frameCapacity() const
+{
+    return d->frameCapacity;
+}
+
+int FramePool::frameCount() const
+{
+    return d->frameCount;
+}
+
+int FramePool::available() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->freeCount;
+}
@@ -0,0 +1,83 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QtGlobal>
+#include <QMetaType>
+
+struct SampleFrameBlock;
+class FramePoolData;
+
+//Block of samples handed from a producer to a GlGraphWidget. Copies share the
+//same samples and only touch a reference count, and the block goes back to its
+//pool when the last copy is released. There is no copy on write: fill a frame
+//before handing it over and leave it alone afterwards.
+class SampleFrame
+{
+public:
+    SampleFrame();
+    //Frame that is not part of a pool, freed when the last copy is released
+    explicit SampleFrame(int capacity);
+    SampleFrame(const SampleFrame &other);
+    ~SampleFrame();
+
+    SampleFrame &operator=(const SampleFrame &other);
+#ifdef Q_COMPILER_RVALUE_REFS
+    SampleFrame(SampleFrame &&other) : d(other.d) { other.d = 0; }
+    SampleFrame &operator=(SampleFrame &&other) { qSwap(d, other.d); return *this; }
+#endif
+    void swap(SampleFrame &other) { qSwap(d, other.d); }
+
+    bool isNull() const;
+    bool isEmpty() const;
+    int size() const;
+    int capacity() const;
+    //Number of valid samples, clamped to the capacity
+    void resize(int size);
+
+    float *data();
+    const float *data() const;
+    const float *constData() const;
+
+    //Drops this reference, the frame becomes null
+    void release();
+
+private:
+    friend class FramePool;
+    explicit SampleFrame(SampleFrameBlock *block);
+
+    SampleFrameBlock *d;
+};
+
+//Fixed number of equally sized frames carved out of one allocation when the
+//pool is created. acquire() and releasing a frame never touch the heap, so a
+//producer that recycles frames streams without any allocation at all. The
+//pool may be destroyed while frames are still in use, its memory is freed
+//once they have all been released.
+class FramePool
+{
+public:
+    FramePool(int frameCapacity, int frameCount);
+    ~FramePool();
+
+    //Returns a null frame when every frame is in use
+    SampleFrame acquire();
+
+    //Replaces the frames with frameCount frames of frameCapacity samples if
+    //they are smaller. The capacity only ever grows, so a steady stream keeps
+    //reusing the same frames. Frames in use keep their old memory until they
+    //are released.
+    void ensureCapacity(int frameCapacity);
+
+    int frameCapacity() const;
+    int frameCount() const;
+    int available() const;
+
+private:
+    Q_DISABLE_COPY(FramePool)
+
+    FramePoolData *d;
+};
+
+Q_DECLARE_METATYPE(SampleFrame)
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,119 @@
+#include "glgraphrenderthread.h"
+#include "glgraphwidget.h"
+#include "glgraphresources.h"
+#include <QMutexLocker>
+
+GlGraphRenderThread::GlGraphRenderThread(QObject *parent)
+    : QThread(parent)
+    , m_bStop(false)
+{
+}
+
+GlGraphRenderThread::~GlGraphRenderThread()
+{
+    //Hand every context back to its widget before stopping
+    m_mutex.lock();
+    QList<GlGraphWidget *> widgets = m_widgets;
+    m_mutex.unlock();
+
+    foreach(GlGraphWidget *widget, widgets)
+        widget->setRenderThread(0);
+
+    m_mutex.lock();
+    m_bStop = true;
+    m_mutex.unlock();
+
+    m_work.release();
+    wait();
+
+    //Its address may be reused by a later thread, which must not inherit the
+    //programs
+    GlGraphResources *resources = GlGraphResources::instance();
+    if(resources)
+        resources->releasePrograms(this);
+}
+
+void GlGraphRenderThread::addWidget(GlGraphWidget *widget)
+{
+    //A context can only be pushed to another thread by the thread that owns
+    //it. Graphs on the raster backend do not have one.
+    if(widget->m_surface)
+    {
+        widget->m_surface->doneCurrent();
+        widget->m_surface->context()->moveToThread(this);
+    }
+
+    m_mutex.lock();
+    m_widgets.append(widget);
+    m_mutex.unlock();
+
+    if(!isRunning())
+        start();
+
+    requestFrame(widget);
+}
+
+void GlGraphRenderThread::removeWidget(GlGraphWidget *widget)
+{
+    QMutexLocker locker(&m_mutex);
+    if(!m_widgets.contains(widget))
+        return;
+
+    //The render thread owns the context now, so it has to hand it back
+    m_removals.append(widget);
+    m_work.release();
+
+    while(m_widgets.contains(widget))
+        m_released.wait(&m_mutex);
+}
+
+void GlGraphRenderThread::requestFrame(GlGraphWidget *widget)
+{
+    //Only wake the thread when the widget goes from idle to dirty
+    if(widget->m_frameRequested.fetchAndStoreOrdered(1) == 0)
+        m_work.release();
+}
+
+void GlGraphRenderThread::run()
+{
+    forever
+    {
+        m_work.acquire();
+        m_work.tryAcquire(m_work.available());
+
+        m_mutex.lock();
+        releaseWidgets();
+        if(m_bStop)
+        {
+            m_mutex.unlock();
+            return;
+        }
+        QList<GlGraphWidget *> widgets = m_widgets;
+        m_mutex.unlock();
+
+        foreach(GlGraphWidget *widget, widgets)
+        {
+            if(widget->m_frameRequested.fetchAndStoreOrdered(0))
+                widget->RenderThreadFrame();
+        }
+    }
+}
+
+void GlGraphRenderThread::releaseWidgets()
+{
+    if(m_removals.isEmpty())
+        return;
+
+    foreach(GlGraphWidget *widget, m_removals)
+    {
+        if(widget->m_surface)
+        {
+            widget->m_surface->doneCurrent();
+            widget->m_surface->context()->moveToThread(widget->thread());
+        }
+        m_widgets.removeAll(widget);
+    }
+
+    m_removals.clear();
+    m_released.wakeAll();
+}
@@ -0,0 +1,47 @@
+#ifndef GLGRAPHRENDERTHREAD_H
+#define GLGRAPHRENDERTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSemaphore>
+#include <QList>
+
+class GlGraphWidget;
+
+//Renders GlGraphWidgets outside of the GUI thread. The thread owns the GL
+//context of every widget attached with GlGraphWidget::setRenderThread() and
+//draws a widget whenever it has published new state, so the traces keep
+//moving while the GUI thread is busy. Several widgets can share one thread,
+//or each widget can be given its own; every thread draws with its own
+//instances of the shader programs.
+class GlGraphRenderThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit GlGraphRenderThread(QObject *parent = 0);
+    ~GlGraphRenderThread();
+
+protected:
+    virtual void run();
+
+private:
+    friend class GlGraphWidget;
+
+    //Called from the GUI thread by GlGraphWidget
+    void addWidget(GlGraphWidget *widget);
+    void removeWidget(GlGraphWidget *widget);
+    void requestFrame(GlGraphWidget *widget);
+
+    void releaseWidgets();
+
+    QMutex m_mutex;
+    QWaitCondition m_released;
+    QList<GlGraphWidget *> m_widgets;
+    QList<GlGraphWidget *> m_removals;
+    bool m_bStop;
+
+    QSemaphore m_work;
+};
+
+#endif // GLGRAPHRENDERTHREAD_H
@@ -0,0 +1,154 @@
+#include "glgraphresources.h"
+#include "graphkernels.h"
+#include <QGLWidget>
+#include <QGLShaderProgram>
+#include <QVector>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
+
+GlGraphResources *GlGraphResources::s_instance = 0;
+int GlGraphResources::s_refCount = 0;
+QMutex GlGraphResources::s_mutex;
+
+GlGraphResources::GlGraphResources()
+    : m_shareWidget(new QGLWidget())
+{
+}
+
+GlGraphResources::~GlGraphResources()
+{
+    //Programs and buffers must be deleted with a context of the group current
+    m_shareWidget->makeCurrent();
+
+    qDeleteAll(m_programs);
+    m_programs.clear();
+
+    foreach(SharedBuffer shared, m_xAxisBuffers)
+        shared.buffer.destroy();
+    m_xAxisBuffers.clear();
+
+    m_shareWidget->doneCurrent();
+    delete m_shareWidget;
+}
+
+GlGraphResources *GlGraphResources::acquire()
+{
+    QMutexLocker locker(&s_mutex);
+    if(!s_instance)
+        s_instance = new GlGraphResources();
+
+    s_refCount++;
+    return s_instance;
+}
+
+void GlGraphResources::release()
+{
+    QMutexLocker locker(&s_mutex);
+    if(s_refCount == 0)
+        return;
+
+    s_refCount--;
+    if(s_refCount == 0)
+    {
+        delete s_instance;
+        s_instance = 0;
+    }
+}
+
+GlGraphResources *GlGraphResources::instance()
+{
+    QMutexLocker locker(&s_mutex);
+    return s_instance;
+}
+
+QGLWidget *GlGraphResources::shareWidget() const
+{
+    return m_shareWidget;
+}
+
+QGLShaderProgram *GlGraphResources::program(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    QPair<QThread *, QString> key(QThread::currentThread(), name);
+    QGLShaderProgram *program = m_programs.value(key, 0);
+    if(program)
+        return program;
+
+    program = new QGLShaderProgram();
+    program->addShaderFromSourceFile(QGLShader::Vertex, QString(":/%1.vert").arg(name));
+    program->addShaderFromSourceFile(QGLShader::Fragment, QString(":/%1.frag").arg(name));
+    if(!program->link())
+        qWarning() << "GlGraphResources: failed to link" << name << program->log();
+
+    m_programs.insert(key, program);
+    return program;
+}
+
+void GlGraphResources::releasePrograms(QThread *thread)
+{
+    QMutexLocker locker(&m_mutex);
+    QList<QGLShaderProgram *> programs;
+    QHash<QPair<QThread *, QString>, QGLShaderProgram *>::iterator it = m_programs.begin();
+    while(it != m_programs.end())
+    {
+        if(it.key().first == thread)
+        {
+            programs.append(it.value());
+            it = m_programs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if(programs.isEmpty())
+        return;
+
+    //Any context of the share group will do
+    m_shareWidget->makeCurrent();
+    qDeleteAll(programs);
+    m_shareWidget->doneCurrent();
+}
+
+QGLBuffer GlGraphResources::acquireXAxisBuffer(int size)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<int, SharedBuffer>::iterator it = m_xAxisBuffers.find(size);
+    if(it != m_xAxisBuffers.end())
+    {
+        it->refCount++;
+        return it->buffer;
+    }
+
+    QVector<float> xAxis(size);
+    FillXAxis(xAxis.data(), size);
+
+    SharedBuffer shared;
+    shared.buffer = QGLBuffer(QGLBuffer::VertexBuffer);
+    shared.buffer.setUsagePattern(QGLBuffer::StaticDraw);
+    shared.buffer.create();
+    shared.buffer.bind();
+    shared.buffer.allocate(xAxis.constData(), size * sizeof(float));
+    shared.buffer.release();
+    shared.refCount = 1;
+
+    m_xAxisBuffers.insert(size, shared);
+    return shared.buffer;
+}
+
+void GlGraphResources::releaseXAxisBuffer(int size)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<int, SharedBuffer>::iterator it = m_xAxisBuffers.find(size);
+    if(it == m_xAxisBuffers.end())
+        return;
+
+    it->refCount--;
+    if(it->refCount == 0)
+    {
+        it->buffer.destroy();
+        m_xAxisBuffers.erase(it);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef GLGRAPHRESOURCES_H
+#define GLGRAPHRESOURCES_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QMutex>
+#include <QGLBuffer>
+
+class QGLWidget;
+class QGLShaderProgram;
+class QThread;
+
+//GL objects shared by every GlGraphWidget in the application. All graph
+//widgets are created in the share group of a hidden context, so each shader
+//program is compiled once and buffers that only depend on the sample count
+//(the X axis) are uploaded once for all graphs of the same size.
+//
+//Graphs may render on several threads (see GlGraphRenderThread), so every
+//method is thread safe. Uniforms belong to the program object and would be
+//shared between threads drawing at the same time, so each thread gets its
+//own instance of a program; buffers only hold fixed data and are shared.
+class GlGraphResources
+{
+public:
+    static GlGraphResources *acquire();
+    static void release();
+    static GlGraphResources *instance();
+
+    QGLWidget *shareWidget() const;
+
+    //Must be called with a context of the share group current. Returns the
+    //instance belonging to the calling thread.
+    QGLShaderProgram *program(const QString &name);
+    //Frees the programs of a thread that will not draw again
+    void releasePrograms(QThread *thread);
+    QGLBuffer acquireXAxisBuffer(int size);
+    void releaseXAxisBuffer(int size);
+
+private:
+    GlGraphResources();
+    ~GlGraphResources();
+
+    struct SharedBuffer
+    {
+        QGLBuffer buffer;
+        int refCount;
+    };
+
+    static GlGraphResources *s_instance;
+    static int s_refCount;
+    static QMutex s_mutex;
+
+    QMutex m_mutex;
+    QGLWidget *m_shareWidget;
+    QHash<QPair<QThread *, QString>, QGLShaderProgram *> m_programs;
+    QHash<int, SharedBuffer> m_xAxisBuffers;
+};
+
+#endif // GLGRAPHRESOURCES_H
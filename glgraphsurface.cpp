@@ -0,0 +1,31 @@
+#include "glgraphsurface.h"
+#include "glgraphwidget.h"
+
+GlGraphSurface::GlGraphSurface(GlGraphWidget *graph, const QGLWidget *shareWidget)
+    : QGLWidget(graph, shareWidget)
+    , m_graph(graph)
+{
+    setAutoFillBackground(false);
+}
+
+void GlGraphSurface::initializeGL()
+{
+    m_graph->initializeGL();
+}
+
+void GlGraphSurface::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    m_graph->SurfacePaint();
+}
+
+void GlGraphSurface::resizeEvent(QResizeEvent *event)
+{
+    //QGLWidget would make the context current here, which is not allowed
+    //while it belongs to the render thread. The graph updates its layout
+    //itself.
+    if(m_graph->m_renderThread)
+        return;
+
+    QGLWidget::resizeEvent(event);
+}
@@ -0,0 +1,27 @@
+#ifndef GLGRAPHSURFACE_H
+#define GLGRAPHSURFACE_H
+
+#include <QGLWidget>
+
+class GlGraphWidget;
+
+//GL window of a GlGraphWidget using the OpenGL backend. It covers the whole
+//graph and hands painting back to it; mouse events fall through to the graph.
+//Only created once the OpenGL backend is used, so a graph that stays on the
+//raster backend never creates a GL context.
+class GlGraphSurface : public QGLWidget
+{
+    Q_OBJECT
+public:
+    GlGraphSurface(GlGraphWidget *graph, const QGLWidget *shareWidget);
+
+protected:
+    virtual void initializeGL();
+    virtual void paintEvent(QPaintEvent *event);
+    virtual void resizeEvent(QResizeEvent *event);
+
+private:
+    GlGraphWidget *m_graph;
+};
+
+#endif // GLGRAPHSURFACE_H
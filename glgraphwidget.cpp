@@ -1,167 +1,484 @@
 #include "glgraphwidget.h"
+#include "glgraphresources.h"
+#include "graphkernels.h"
 #include <QDebug>
 #include <QPointF>
 #include <QMouseEvent>
-#include "float.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QVector2D>
+#include <QOpenGLContext>
+#include <QFontDatabase>
+#include "glgraphrenderthread.h"
+#include "glgraphsurface.h"
+#include <QMutexLocker>
+#include <string.h>
 #include "math.h"
 
 #define TEXT_MARGIN 10
+#define MAX_PENDING_SPECTRUM_BLOCKS 8
+#define LABEL_LAYOUT_INTERVAL 15
+//Frames a graph can hold at once: m_state, m_renderState, the three triple
+//buffer slots and the one being filled
+#define FRAME_POOL_SIZE 6
+
+GlGraphWidget::ViewState::ViewState()
+    : axisColor(QColor::fromRgb(255,255,255,255))
+    , gridColor(QColor::fromRgb(100,100,100))
+    , lineColor(QColor::fromRgb(255,0,0))
+    , bgColor(QColor::fromRgb(0,0,0))
+    , axisLineWidth(2)
+    , gridLineWidth(1)
+    , lineWidth(1)
+    , xDataMin(0)
+    , xDataMax(0)
+    , min(0)
+    , max(0)
+    , sampleCount(0)
+    , alarmColor(QColor::fromRgb(255,200,0,80))
+    , yMin(-1)
+    , yMax(1)
+    , xMin(0)
+    , xMax(0)
+    , autoScale(true)
+    , gridSizeX(10)
+    , gridSizeY(10)
+    , axisStyle(LeftAxis)
+    , displayMode(LineMode)
+    , renderBackend(OpenGLBackend)
+    , headerEnabled(false)
+    , headerText("")
+    , headerFont(QFont("Arial", 12))
+    , headerColor(QColor::fromRgb(255,255,255,255))
+    , footerEnabled(false)
+    , footerText("")
+    , footerFont(QFont("Arial", 8))
+    , footerColor(QColor::fromRgb(255,255,255,255))
+    , axisFont(QFont("Arial", 9))
+    , axisTextColor(QColor::fromRgb(255,255,255,255))
+    , pixelRatio(1)
+    , dataSerial(0)
+    , layoutSerial(0)
+{
+    zoomMatrix.setToIdentity();
+    dataMatrix.setToIdentity();
+    transformMatrix.setToIdentity();
+}
 
 GlGraphWidget::GlGraphWidget(QWidget *parent)
-   : QGLWidget(parent)
-   , m_axisColor(QColor::fromRgb(255,255,255,255))
-   , m_gridColor(QColor::fromRgb(100,100,100))
-   , m_lineColor(QColor::fromRgb(255,0,0))
-   , m_bgColor(QColor::fromRgb(0,0,0))
-   , m_fAxisLineWidth(2)
-   , m_fGridLineWidth(1)
-   , m_fLineWidth(1)
-   , m_fMin(0)
-   , m_fMax(0)
-   , m_fYMin(-1)
-   , m_fYMax(1)
-   , m_bAutoScale(true)
-   , m_bInitialized(false)
-   , m_iGridSizeX(10)
-   , m_iGridSizeY(10)
-   , m_axisStyle(LeftAxis)
+   : QWidget(parent)
+   , m_margins(QMargins(20,10,20,10))
    , m_fZoomStepSize((float)0.1)
    , m_bRecalcMargins(true)
-   , m_bUpdateGridBuffer(true)
-   , m_bHeaderEnabled(false)
-   , m_sHeaderText("")
-   , m_fntHeaderFont(QFont("Arial", 12))
-   , m_cHeaderColor(QColor::fromRgb(255,255,255,255))
-   , m_bFooterEnabled(false)
-   , m_sFooterText("")
-   , m_fntFooterFont(QFont("Arial", 8))
-   , m_cFooterColor(QColor::fromRgb(255,255,255,255))
-   , m_fntAxisFont(QFont("Arial", 9))
-   , m_cAxisTextColor(QColor::fromRgb(255,255,255,255))
-   , m_margins(QMargins(20,10,20,10))
+   , m_spectrumThread(0)
+   , m_spectrumAnalyzer(0)
+   , m_framePool(0, FRAME_POOL_SIZE)
+   , m_xFramePool(0, FRAME_POOL_SIZE)
+   , m_renderThread(0)
+   , m_frameRequested(0)
+   , m_qualityLevel(QualityController::FullQuality)
+   , m_averageFrameTime(0)
+   , m_surface(0)
+   , m_bInitialized(false)
+   , m_programThread(0)
+   , m_gridShader(0)
+   , m_graphShader(0)
+   , m_iXAxisBufferSize(0)
+   , m_densityShader(0)
+   , m_alarmShader(0)
+   , m_densityTexture(0)
+   , m_iDensitySerial(-1)
+   , m_bDensityTextureStale(true)
+   , m_bLayoutLabels(true)
+   , m_iFramesSinceLabelLayout(0)
+   , m_iLabelLayoutSerial(-1)
 {
     setAutoFillBackground(false);
-    m_transformMatrix.setToIdentity();
-    m_zoomMatrix.setToIdentity();
+}
+
+GlGraphWidget::~GlGraphWidget()
+{
+    //Take the context back before touching any GL resources
+    if(m_renderThread)
+        m_renderThread->removeWidget(this);
+
+    if(m_spectrumThread)
+    {
+        m_spectrumThread->quit();
+        m_spectrumThread->wait();
+        delete m_spectrumAnalyzer;
+    }
+
+    //A graph that only used the raster backend never had a GL context
+    if(!m_surface)
+        return;
+
+    m_surface->makeCurrent();
+
+    if(m_iXAxisBufferSize != 0)
+        GlGraphResources::instance()->releaseXAxisBuffer(m_iXAxisBufferSize);
+
+    if(m_densityTexture != 0)
+        glDeleteTextures(1, &m_densityTexture);
+
+    m_surface->doneCurrent();
+    delete m_surface;
+    m_surface = 0;
+
+    //The share widget has to outlive every surface created with it
+    GlGraphResources::release();
 }
 
 void GlGraphWidget::setGridColor(const QColor &color)
 {
-    m_gridColor = color;
+    m_state.gridColor = color;
+    StateChanged();
 }
 
 void GlGraphWidget::setLineColor(const QColor &color)
 {
-    m_lineColor = color;
+    m_state.lineColor = color;
+    StateChanged();
 }
 
 void GlGraphWidget::setBgColor(const QColor &color)
 {
-    m_bgColor = color;
+    m_state.bgColor = color;
+    StateChanged();
 }
 
 void GlGraphWidget::setLineWidth(float width)
 {
-    m_fLineWidth = width;
+    m_state.lineWidth = width;
+    StateChanged();
 }
 
 void GlGraphWidget::setGridLineWidth(float width)
 {
-    m_fGridLineWidth = width;
+    m_state.gridLineWidth = width;
+    StateChanged();
 }
 
 void GlGraphWidget::setAxisLineWidth(float width)
 {
-    m_fAxisLineWidth = width;
+    m_state.axisLineWidth = width;
+    StateChanged();
 }
 
 void GlGraphWidget::setAxisStyle(AxisStyle style)
 {
-    m_axisStyle = style;
-    UpdateGrid();
+    m_state.axisStyle = style;
     UpdateMargins();
+    StateChanged();
+}
+
+void GlGraphWidget::setDisplayMode(DisplayMode mode)
+{
+    if(mode == SpectrumMode && m_state.displayMode != SpectrumMode)
+        StartSpectrumAnalyzer();
+
+    m_state.displayMode = mode;
+    m_state.dataSerial++;
+
+    //Whether the history view may use block extents depends on the mode
+    if(mode != SpectrumMode && m_history.capacity() > 0)
+        UpdateHistoryView();
+    else
+        StateChanged();
+}
+
+GlGraphWidget::DisplayMode GlGraphWidget::displayMode() const
+{
+    return m_state.displayMode;
+}
+
+void GlGraphWidget::setDensityColorMap(const QGradientStops &stops)
+{
+    //The renderer owns the density map and picks the new stops up with the state
+    m_state.densityColorMap = stops;
+    StateChanged();
+}
+
+void GlGraphWidget::setSpectrumSettings(const SpectrumAnalyzer::Settings &settings)
+{
+    m_spectrumSettings = settings;
+
+    if(m_spectrumAnalyzer)
+    {
+        QMetaObject::invokeMethod(m_spectrumAnalyzer, "setSettings", Qt::QueuedConnection,
+                                  Q_ARG(SpectrumAnalyzer::Settings, settings));
+    }
 }
 
 void GlGraphWidget::setData(const QVector<float> &data)
 {
-    //init x axis
-    if(m_xAxis.size() != data.size())
+    if(m_state.displayMode == SpectrumMode)
     {
-        float curX = -1.0;
-        float stepSize = (float)2.0/(float)data.size();
+        QueueSpectrumBlock(data);
+        return;
+    }
 
-        m_xAxis.resize(data.size());
+    if(m_history.capacity() > 0)
+    {
+        m_history.append(data.constData(), data.size());
+        DetectAlarms(data.constData(), data.size());
+        UpdateHistoryView();
+        return;
+    }
 
-        for(int i = 0; i < data.size(); i++)
-        {
-            curX += stepSize;
-            m_xAxis[i] = curX;
-        }
+    DetectAlarms(data.constData(), data.size());
+
+    //One copy into a recycled frame, the caller's vector is not kept so
+    //writing to it later does not make it detach
+    SetDisplayData(CopyToFrame(m_framePool, data.constData(), data.size()));
+}
+
+void GlGraphWidget::setData(const SampleFrame &frame)
+{
+    if(m_state.displayMode == SpectrumMode)
+    {
+        //The analyzer holds a reference until it has consumed the samples
+        QueueSpectrumBlock(frame);
+        return;
+    }
+
+    if(m_history.capacity() > 0)
+    {
+        m_history.append(frame.constData(), frame.size());
+        DetectAlarms(frame.constData(), frame.size());
+        UpdateHistoryView();
+        return;
     }
 
+    DetectAlarms(frame.constData(), frame.size());
+    SetDisplayData(frame);
+}
+
+bool GlGraphWidget::ReserveSpectrumBlock()
+{
+    //The FFT runs on the worker thread, the result comes back in spectrumReady().
+    //Blocks are dropped rather than queued without bound if it falls behind.
+    if(m_spectrumAnalyzer->pendingBlocks() >= MAX_PENDING_SPECTRUM_BLOCKS)
+        return false;
+
+    m_spectrumAnalyzer->blockQueued();
+    return true;
+}
+
+void GlGraphWidget::QueueSpectrumBlock(const QVector<float> &data)
+{
+    if(ReserveSpectrumBlock())
+        QMetaObject::invokeMethod(m_spectrumAnalyzer, "process", Qt::QueuedConnection,
+                                  Q_ARG(QVector<float>, data));
+}
+
+void GlGraphWidget::QueueSpectrumBlock(const SampleFrame &data)
+{
+    if(ReserveSpectrumBlock())
+        QMetaObject::invokeMethod(m_spectrumAnalyzer, "process", Qt::QueuedConnection,
+                                  Q_ARG(SampleFrame, data));
+}
+
+void GlGraphWidget::spectrumReady(const SampleFrame &spectrum)
+{
+    //Shown as is, the analyzer writes each spectrum into a frame of its own
+    if(m_state.displayMode == SpectrumMode)
+        SetDisplayData(spectrum);
+}
+
+void GlGraphWidget::SetDisplayData(const SampleFrame &data)
+{
+    m_state.xData = SampleFrame();
+    m_state.yData = data;
+    m_state.sampleCount = data.size();
+    m_state.dataMatrix.setToIdentity();
+    m_state.dataSerial++;
+
+    //Spectra are not checked against the alarm limits
+    if(m_state.displayMode == SpectrumMode)
+        m_state.alarmSpans.clear();
+    else
+        UpdateAlarmSpans(0, data.size());
+
     //Find limits of Y axis
-    m_yAxis = data;
-    m_fMax = FLT_MIN_EXP;
-    m_fMin = FLT_MAX_EXP;
+    m_state.min = 0;
+    m_state.max = 0;
+    if(!data.isEmpty())
+        FindExtents(data.constData(), data.size(), m_state.min, m_state.max);
+
+    //Request an update
+    StateChanged();
+}
+
+SampleFrame GlGraphWidget::AcquireFrame(FramePool &pool, int count)
+{
+    pool.ensureCapacity(count);
+
+    SampleFrame frame = pool.acquire();
+    if(frame.isNull())
+        frame = SampleFrame(count); //Every pooled frame is still in flight
+
+    frame.resize(count);
+    return frame;
+}
 
-    for(int i = 0; i < data.size(); i++)
+SampleFrame GlGraphWidget::CopyToFrame(FramePool &pool, const float *data, int count)
+{
+    SampleFrame frame = AcquireFrame(pool, count);
+    if(count > 0)
+        memcpy(frame.data(), data, count * sizeof(float));
+
+    return frame;
+}
+
+void GlGraphWidget::UpdateHistoryView()
+{
+    int total = m_history.size();
+    int blockSize = m_history.blockSize();
+
+    //Visible part of the history after zooming, in whole blocks
+    CalculateMargins();
+    const QMatrix4x4 &zoom = m_state.zoomMatrix;
+    float left = (-1 - zoom(0,3)) / zoom(0,0);
+    float right = (1 - zoom(0,3)) / zoom(0,0);
+    int firstSample = qBound(0, (int)floor(((left + 1) / 2) * total), total);
+    int lastSample = qBound(0, (int)ceil(((right + 1) / 2) * total), total);
+    int firstBlock = firstSample / blockSize;
+    int blocks = qMax(0, ((lastSample + blockSize - 1) / blockSize) - firstBlock);
+
+    int columns = m_state.transformMatrix(0,0) * m_state.size.width();
+    int span = qMin(total, (firstBlock + blocks) * blockSize) - (firstBlock * blockSize);
+
+    SampleFrame frame;
+    //The density map bins every value as a sample, the min/max pairs of the
+    //block headers would show up as samples of their own
+    if(m_state.displayMode != DensityMode && (lastSample - firstSample) >= blockSize * qMax(1, columns))
+    {
+        //Every block is narrower than a pixel column, the headers are enough
+        frame = AcquireFrame(m_framePool, 2 * blocks);
+        m_history.blockExtents(firstBlock, blocks, frame.data());
+    }
+    else
     {
-        float tmp = data.constData()[i];
-        if(tmp < m_fMin)
-            m_fMin = tmp;
-        if(tmp > m_fMax)
-            m_fMax = tmp;
+        frame = AcquireFrame(m_framePool, blocks * blockSize);
+        frame.resize(m_history.decode(firstBlock, blocks, frame.data()));
     }
 
-    //Request an update
-    if(m_bInitialized)
+    m_state.xData = SampleFrame();
+    m_state.yData = frame;
+    m_state.sampleCount = total;
+    m_state.dataSerial++;
+    m_history.extents(m_state.min, m_state.max);
+    UpdateAlarmSpans(firstSample, lastSample);
+
+    //Place the decoded part within the X range of the whole history
+    m_state.dataMatrix.setToIdentity();
+    if(total > 0 && span > 0)
     {
-        update();
+        m_state.dataMatrix.translate(-1 + ((2.0 * (firstBlock * blockSize) + span) / total), 0);
+        m_state.dataMatrix.scale((float)span / total, 1);
     }
+
+    StateChanged();
+}
+
+void GlGraphWidget::DetectAlarms(const float *data, int count)
+{
+    //One pass over the new samples, events that scrolled out of the history
+    //or the latest block are forgotten
+    m_alarms.append(data, count);
+
+    int shown = (m_history.capacity() > 0) ? m_history.size() : count;
+    m_alarms.discardBefore(m_alarms.position() - shown);
+}
+
+void GlGraphWidget::UpdateAlarmSpans(int firstSample, int lastSample)
+{
+    //Sample 0 of the X axis is the oldest sample shown
+    m_state.alarmSpans.clear();
+    if(m_alarms.isEnabled())
+        m_alarms.events(m_alarms.position() - m_state.sampleCount, firstSample, lastSample, m_state.alarmSpans);
+}
+
+void GlGraphWidget::setScatterData(const QVector<float> &x, const QVector<float> &y)
+{
+    int count = qMin(x.size(), y.size());
+
+    //Scatter data holds two frames per state, X comes from a pool of its own
+    m_state.xData = CopyToFrame(m_xFramePool, x.constData(), count);
+    m_state.yData = CopyToFrame(m_framePool, y.constData(), count);
+    m_state.sampleCount = count;
+    m_state.dataMatrix.setToIdentity();
+    m_state.alarmSpans.clear();
+    m_state.dataSerial++;
+
+    if(count > 0)
+    {
+        FindExtents(m_state.xData.constData(), count, m_state.xDataMin, m_state.xDataMax);
+        FindExtents(m_state.yData.constData(), count, m_state.min, m_state.max);
+    }
+
+    //Request an update
+    StateChanged();
 }
 
 void GlGraphWidget::setYAxisLimits(float min, float max)
 {
-    m_fYMin = min;
-    m_fYMax = max;
-    m_bAutoScale = false;
+    m_state.yMin = min;
+    m_state.yMax = max;
+    m_state.autoScale = false;
+    StateChanged();
 }
 
 void GlGraphWidget::setXAxisLimits(float min, float max)
 {
-    m_fXMin = min;
-    m_fXMax = max;
+    m_state.xMin = min;
+    m_state.xMax = max;
+    StateChanged();
 }
 
 void GlGraphWidget::setAutoScale(bool scale)
 {
-    m_bAutoScale = scale;
+    m_state.autoScale = scale;
 
     if(scale)
     {
-        m_fYMin = -1.0;
-        m_fYMax = 1.0;
+        m_state.yMin = -1.0;
+        m_state.yMax = 1.0;
     }
+
+    StateChanged();
 }
 
 void GlGraphWidget::setGridSize(int x, int y)
 {
-    m_iGridSizeX = x;
-    m_iGridSizeY = y;
+    m_state.gridSizeX = x;
+    m_state.gridSizeY = y;
 
-    UpdateGrid();
+    m_state.layoutSerial++;
+    StateChanged();
 }
 
 void GlGraphWidget::zoom(float zoomFactor, const QPointF &offset)
 {
-    m_zoomMatrix.translate(offset.x(), offset.y());
-    m_zoomMatrix.scale(zoomFactor);
-    m_zoomMatrix.translate(offset.x() * -zoomFactor, offset.y() * -zoomFactor);
+    m_state.zoomMatrix.translate(offset.x(), offset.y());
+    m_state.zoomMatrix.scale(zoomFactor);
+    m_state.zoomMatrix.translate(offset.x() * -zoomFactor, offset.y() * -zoomFactor);
+
+    if(m_history.capacity() > 0)
+        UpdateHistoryView();
+    else
+        StateChanged();
 }
 
 void GlGraphWidget::resetZoom()
 {
-    m_zoomMatrix.setToIdentity();
+    m_state.zoomMatrix.setToIdentity();
+
+    if(m_history.capacity() > 0)
+        UpdateHistoryView();
+    else
+        StateChanged();
 }
 
 void GlGraphWidget::setZoomStepSize(float stepSize)
@@ -172,197 +489,670 @@ void GlGraphWidget::setZoomStepSize(float stepSize)
 void GlGraphWidget::initializeGL()
 {
     glEnable(GL_MULTISAMPLE);
+    LoadPrograms();
 
-    m_graphShader.addShaderFromSourceFile(QGLShader::Vertex, ":/graphshader.vert");
-    m_graphShader.addShaderFromSourceFile(QGLShader::Fragment, ":/graphshader.frag");
-    m_graphShader.link();
-    m_graphShader.bind();
+    m_bInitialized = true;
+}
 
-    m_gridShader.addShaderFromSourceFile(QGLShader::Vertex, ":/gridshader.vert");
-    m_gridShader.addShaderFromSourceFile(QGLShader::Fragment, ":/gridshader.frag");
-    m_gridShader.link();
-    m_gridShader.bind();
+void GlGraphWidget::LoadPrograms()
+{
+    //Each thread draws with its own programs, so they are fetched again
+    //whenever the widget moves to or from a render thread
+    if(m_programThread == QThread::currentThread())
+        return;
 
-    m_bInitialized = true;
+    GlGraphResources *resources = GlGraphResources::instance();
+    m_graphShader = resources->program("graphshader");
+    m_gridShader = resources->program("gridshader");
+    m_densityShader = resources->program("densityshader");
+    m_alarmShader = resources->program("alarmshader");
+    m_programThread = QThread::currentThread();
 }
 
 void GlGraphWidget::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event)
-    makeCurrent(); //Make the GL context current
+
+    //The OpenGL backend paints its surface, see SurfacePaint()
+    if(m_state.renderBackend != RasterBackend)
+        return;
+
+    //Drawn by the render thread, only the finished image is shown here
+    if(m_renderThread)
+    {
+        QMutexLocker locker(&m_presentMutex);
+        QPainter p(this);
+        p.drawImage(0, 0, m_presentedImage);
+        return;
+    }
 
     CalculateMargins();
-    CreateGridBuffer();
+    m_renderState = m_state;
 
-    qglClearColor(m_bgColor);
-    glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
-    glLoadIdentity();
+    RenderFrame();
 
-    drawGrid();
+    QPainter p(this);
+    p.drawImage(0, 0, m_rasterImage);
+}
 
-    //Set up the graph shader
-    m_graphShader.bind();
-    m_graphShader.setUniformValue("transform", m_transformMatrix);
-    m_graphShader.setUniformValue("zoom", m_zoomMatrix);
-    m_graphShader.setUniformValue("texture", 0);
-    m_graphShader.setUniformValue("lineColor", m_lineColor);
-    m_graphShader.setUniformValue("scaleFactor", getScaleFactor());
-    m_graphShader.setUniformValue("yOffset", getYOffset());
-    m_graphShader.enableAttributeArray("xAxis");
-    m_graphShader.setAttributeArray("xAxis", (GLfloat *)m_xAxis.constData(), 1, 0);
-    m_graphShader.enableAttributeArray("yAxis");
-    m_graphShader.setAttributeArray("yAxis", (GLfloat *)m_yAxis.constData(), 1, 0);
-
-
-    //Calculate the clippring region
-    QPointF bottomLeft = m_transformMatrix.map(QPointF(-1,-1));
-    QPointF topRight = m_transformMatrix.map(QPointF(1,1));
-    bottomLeft.setX((bottomLeft.x() + 1) * width()/2);
-    bottomLeft.setY((bottomLeft.y() + 1) * height()/2);
-    topRight.setX((topRight.x() + 1) * width()/2);
-    topRight.setY((topRight.y() + 1) * height()/2);
+void GlGraphWidget::SurfacePaint()
+{
+    //The render thread owns the context, just ask it to draw again
+    if(m_renderThread)
+    {
+        m_renderThread->requestFrame(this);
+        return;
+    }
 
-    //Enable clipping
-    glEnable(GL_SCISSOR_TEST);
-    glScissor(bottomLeft.x(), bottomLeft.y(), topRight.x() - bottomLeft.x(), topRight.y() - bottomLeft.y());
+    m_surface->makeCurrent(); //Make the GL context current
+    LoadPrograms();
 
-    //Draw the graph
-    glLineWidth(m_fLineWidth);
-    glDrawArrays(GL_LINE_STRIP, 0, m_xAxis.size());
-    glDisable(GL_SCISSOR_TEST);
+    CalculateMargins();
+    m_renderState = m_state;
 
-    drawAxis();
+    RenderFrame();
+}
 
-    //Clean up
-    glLineWidth(1);
+void GlGraphWidget::resizeEvent(QResizeEvent *event)
+{
+    Q_UNUSED(event)
 
-    drawText();
+    if(m_surface)
+        m_surface->setGeometry(rect());
+
+    UpdateMargins();
+
+    //The history view is decoded for the width of the plot, it cannot wait
+    //for the next setData() as paused data never brings one
+    if(m_history.capacity() > 0)
+        UpdateHistoryView();
+    else
+        StateChanged();
 }
 
-void GlGraphWidget::drawAxis()
+void GlGraphWidget::showEvent(QShowEvent *event)
 {
-    if(m_axisStyle == NoAxis)
-        return;
+    Q_UNUSED(event)
 
-    m_gridShader.bind();
-    m_gridShader.setUniformValue("transform", m_transformMatrix);
-    m_gridShader.enableAttributeArray("vertex");
-    m_gridShader.setAttributeArray("vertex", (GLfloat *)m_fvGridVBuffer.constData(), 2, 0);
+    //Deferred until now so the raster backend can be chosen first
+    if(m_state.renderBackend == OpenGLBackend)
+        CreateSurface();
+}
 
-    //Draw Axis
-    m_gridShader.setUniformValue("lineColor", m_axisColor);
-    glLineWidth(m_fAxisLineWidth);
-    glDrawArrays(GL_LINES, 0, 4);
+void GlGraphWidget::CreateSurface()
+{
+    if(m_surface)
+        return;
 
-    m_gridShader.disableAttributeArray("vertex");
-    m_gridShader.release();
+    m_surface = new GlGraphSurface(this, GlGraphResources::acquire()->shareWidget());
+    m_surface->setGeometry(rect());
+    m_surface->setVisible(m_state.renderBackend == OpenGLBackend);
 }
 
-void GlGraphWidget::drawGrid()
+void GlGraphWidget::RenderThreadFrame()
 {
-    if(m_fvGridVBuffer.size() <= 8)
+    if(m_stateBuffer.update())
+        m_renderState = m_stateBuffer.readBuffer();
+
+    if(m_renderState.renderBackend == RasterBackend)
+    {
+        RenderFrame();
+
+        //Shown by paintEvent() on the GUI thread
+        m_presentMutex.lock();
+        qSwap(m_rasterImage, m_presentedImage);
+        m_presentMutex.unlock();
+
+        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
         return;
+    }
 
-    m_gridShader.bind();
-    m_gridShader.setUniformValue("transform", m_transformMatrix);
-    m_gridShader.enableAttributeArray("vertex");
-    m_gridShader.setAttributeArray("vertex", (GLfloat *)m_fvGridVBuffer.constData(), 2, 0);
+    if(!m_surface)
+        return;
 
-    //The offset for drawing the grid is 4 if we are drawing an axis, 0 otherwise
-    int bufferStart = 4;
-    if(m_axisStyle == NoAxis)
-        bufferStart = 0;
+    m_surface->makeCurrent();
 
-    //Draw grid
-    m_gridShader.setUniformValue("lineColor", m_gridColor);
-    glLineWidth(m_fGridLineWidth);
-    glDrawArrays(GL_LINES, bufferStart, (2*(m_iGridSizeX + 1)) + (2*(m_iGridSizeY + 1)));
+    if(!m_bInitialized)
+        initializeGL();
+    LoadPrograms();
 
-    m_gridShader.disableAttributeArray("vertex");
-    m_gridShader.release();
+    RenderFrame();
 }
 
-void GlGraphWidget::drawText()
+void GlGraphWidget::StateChanged()
 {
-    QPainter p(this);
-    p.beginNativePainting();
+    if(!m_renderThread)
+    {
+        //Copied to the render state by the next paintEvent()
+        if(m_state.renderBackend == RasterBackend)
+            update();
+        else if(m_surface && m_bInitialized)
+            m_surface->update();
+        return;
+    }
+
+    //Layout depends on fonts, which are only safe to measure on the GUI thread
+    CalculateMargins();
 
-    if(m_bHeaderEnabled)
+    m_stateBuffer.writeBuffer() = m_state;
+    m_stateBuffer.publish();
+    m_renderThread->requestFrame(this);
+}
+
+void GlGraphWidget::RenderFrame()
+{
+    //Everything below only reads m_renderState, so it can run on either thread
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+
+    if(!(m_renderState.qualityPolicy == m_quality.policy()))
     {
-        p.setFont(m_fntHeaderFont);
-        p.setPen(m_cHeaderColor);
-        p.drawText(m_headerRect, Qt::AlignCenter, m_sHeaderText);
-        //p.fillRect(m_headerRect, QColor::fromRgb(255,0,0));
+        QualityController::Level level = m_quality.level();
+        m_quality.setPolicy(m_renderState.qualityPolicy);
+
+        if(m_quality.level() != level)
+        {
+            m_bLayoutLabels = true;
+            m_qualityLevel.store(m_quality.level());
+            emit qualityChanged(m_quality.level());
+        }
     }
 
-    if(m_bFooterEnabled)
+    CalculateTicks();
+
+    if(m_renderState.renderBackend == RasterBackend)
     {
-        p.setFont(m_fntFooterFont);
-        p.setPen(m_cFooterColor);
-        p.drawText(m_footerRect, Qt::AlignLeft | Qt::AlignVCenter, m_sFooterText);
-        //p.fillRect(m_footerRect, QColor::fromRgb(255,0,0));
+        RenderRaster();
     }
+    else
+    {
+        //Set every frame, the QPainter in drawText() resets it
+        qreal ratio = m_renderState.pixelRatio;
+        glViewport(0, 0, qRound(m_renderState.size.width() * ratio), qRound(m_renderState.size.height() * ratio));
+
+        UpdateXAxisBuffer();
+
+        if(m_quality.level() >= QualityController::NoMultisample)
+            glDisable(GL_MULTISAMPLE);
+        else
+            glEnable(GL_MULTISAMPLE);
+
+        m_surface->qglClearColor(m_renderState.bgColor);
+        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+        glLoadIdentity();
+
+        drawGrid();
+        drawAlarms();
 
-    if(m_axisStyle != NoAxis)
+        if(m_renderState.displayMode == DensityMode)
+            drawDensity();
+        else
+            drawLines();
+
+        drawAxis();
+
+        //Clean up
+        glLineWidth(1);
+
+        drawText();
+    }
+
+    //Adapt the quality of the next frames to the time this one took
+    bool levelChanged = m_quality.frameFinished(frameTimer.nsecsElapsed() / 1000000.0);
+    m_averageFrameTime.store(m_quality.averageFrameTime() * 1000);
+
+    if(levelChanged)
     {
-        p.setFont(m_fntAxisFont);
-        p.setPen(m_cAxisTextColor);
+        m_bLayoutLabels = true;
+        m_qualityLevel.store(m_quality.level());
+        emit qualityChanged(m_quality.level());
+    }
+}
 
-        QPoint textPos = m_yAxisRect.topLeft();
-        QFontMetrics metrics(m_fntAxisFont);
-        int textSpacing = m_yAxisRect.height() / m_iGridSizeY;
-        int height = metrics.ascent() - metrics.descent();
+void GlGraphWidget::drawLines()
+{
+    //Set up the graph shader
+    m_graphShader->bind();
+    m_graphShader->setUniformValue("transform", m_renderState.transformMatrix);
+    QMatrix4x4 zoom = m_renderState.zoomMatrix * m_renderState.dataMatrix;
+    m_graphShader->setUniformValue("zoom", zoom);
+    m_graphShader->setUniformValue("texture", 0);
+    m_graphShader->setUniformValue("lineColor", m_renderState.lineColor);
+    float scaleFirst, scaleSecond;
+    getScaleFactors(scaleFirst, scaleSecond);
+    m_graphShader->setUniformValue("scaleFactor", scaleFirst, scaleSecond);
+    m_graphShader->setUniformValue("yOffset", getYOffset());
+    m_graphShader->enableAttributeArray("xAxis");
+    m_graphShader->enableAttributeArray("yAxis");
+
+    QRect plotRect = PlotRect();
+
+    //When decimating, draw a min/max pair per visible pixel column instead of every sample
+    int columns = plotRect.width() * zoom(0,0);
+    int points = m_iXAxisBufferSize;
+    if(m_quality.level() >= QualityController::Decimated && columns > 0 && points > 2 * columns)
+    {
+        m_decimatedX.resize(2 * columns);
+        m_decimatedY.resize(2 * columns);
+        points = DecimateMinMax(m_renderState.yData.constData(), m_renderState.yData.size(), columns,
+                                m_decimatedX.data(), m_decimatedY.data());
 
-        float yMin = m_fMin, yMax = m_fMax;
-        if(!m_bAutoScale)
+        m_graphShader->setAttributeArray("xAxis", m_decimatedX.constData(), 1, 0);
+        m_graphShader->setAttributeArray("yAxis", m_decimatedY.constData(), 1, 0);
+    }
+    else
+    {
+        if(m_xAxisBuffer.isCreated())
         {
-            yMin = m_fYMin;
-            yMax = m_fYMax;
+            m_xAxisBuffer.bind();
+            m_graphShader->setAttributeBuffer("xAxis", GL_FLOAT, 0, 1);
+            m_xAxisBuffer.release();
         }
+        m_graphShader->setAttributeArray("yAxis", (GLfloat *)m_renderState.yData.constData(), 1, 0);
+    }
 
-        float numStart = yMax;
-        float numSpacing = (yMax - yMin) / m_iGridSizeY;
+    //Enable clipping
+    glEnable(GL_SCISSOR_TEST);
+    QRect scissorRect = DevicePlotRect();
+    glScissor(scissorRect.x(), scissorRect.y(), scissorRect.width(), scissorRect.height());
 
-        for(int i = 0; i <= m_iGridSizeY; i++)
-        {
-            QPoint drawPoint = textPos;
-            drawPoint.setY(drawPoint.y() + (height/2));
+    //Draw the graph
+    glLineWidth(m_renderState.lineWidth);
+    glDrawArrays(GL_LINE_STRIP, 0, points);
+    glDisable(GL_SCISSOR_TEST);
+
+    m_graphShader->disableAttributeArray("xAxis");
+    m_graphShader->disableAttributeArray("yAxis");
+    m_graphShader->release();
+}
+
+void GlGraphWidget::drawDensity()
+{
+    QRect plotRect = PlotRect();
+    if(plotRect.isEmpty() || m_renderState.yData.isEmpty())
+        return;
+
+    UpdateDensityTexture(plotRect);
+
+    //A single textured quad covering the plot area
+    static const GLfloat quad[] = { -1, -1,  1, -1,  -1, 1,  1, 1 };
 
-            p.drawText(drawPoint, QString::number(numStart, 'f', 4));
-            textPos.setY(textPos.y() + textSpacing);
-            numStart -= numSpacing;
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+
+    m_densityShader->bind();
+    m_densityShader->setUniformValue("transform", m_renderState.transformMatrix);
+    m_densityShader->setUniformValue("densityTexture", 0);
+    m_densityShader->enableAttributeArray("vertex");
+    m_densityShader->setAttributeArray("vertex", quad, 2, 0);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    m_densityShader->disableAttributeArray("vertex");
+    m_densityShader->release();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_BLEND);
+}
+
+void GlGraphWidget::drawAlarms()
+{
+    QRect plotRect = PlotRect();
+    if(plotRect.isEmpty() || m_renderState.alarmSpans.isEmpty())
+        return;
+
+    AlarmBands(plotRect.width(), m_alarmBands);
+    int bands = m_alarmBands.size() / 2;
+    if(bands == 0)
+        return;
+
+    //Two triangles per band, all of them in a single draw call
+    m_alarmVertices.resize(bands * 12);
+    float *vertex = m_alarmVertices.data();
+    for(int i = 0; i < bands; i++)
+    {
+        float left = m_alarmBands[2*i];
+        float right = m_alarmBands[(2*i) + 1];
+        const float quad[] = { left, -1,  right, -1,  left, 1,  left, 1,  right, -1,  right, 1 };
+        memcpy(vertex, quad, sizeof(quad));
+        vertex += 12;
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_alarmShader->bind();
+    m_alarmShader->setUniformValue("transform", m_renderState.transformMatrix);
+    m_alarmShader->setUniformValue("alarmColor", m_renderState.alarmColor);
+    m_alarmShader->enableAttributeArray("vertex");
+    m_alarmShader->setAttributeArray("vertex", m_alarmVertices.constData(), 2, 0);
+
+    glDrawArrays(GL_TRIANGLES, 0, bands * 6);
+
+    m_alarmShader->disableAttributeArray("vertex");
+    m_alarmShader->release();
+
+    glDisable(GL_BLEND);
+}
+
+void GlGraphWidget::AlarmBands(float plotWidth, QVector<float> &bands)
+{
+    //Alarm spans in normalized plot coordinates after zooming. Bands are made
+    //at least a pixel wide and merged where they touch, so there are never
+    //more than plotWidth of them however many alarms are in view.
+    bands.resize(0);
+
+    const ViewState &state = m_renderState;
+    if(state.sampleCount <= 0 || plotWidth <= 0)
+        return;
+
+    //Each sample covers half a step either side of its point on the line
+    const QMatrix4x4 &zoom = state.zoomMatrix;
+    float step = (float)2.0/(float)state.sampleCount;
+    float scale = step * zoom(0,0);
+    float offset = ((-1 + (step / 2)) * zoom(0,0)) + zoom(0,3);
+    float pixel = 2 / plotWidth;
+
+    for(int i = 0; i + 1 < state.alarmSpans.size(); i += 2)
+    {
+        float left = (state.alarmSpans[i] * scale) + offset;
+        float right = (state.alarmSpans[i + 1] * scale) + offset;
+        if(right - left < pixel)
+        {
+            float centre = (left + right) / 2;
+            left = centre - (pixel / 2);
+            right = centre + (pixel / 2);
         }
 
-        // X AXIS
-        textPos = m_xAxisRect.bottomLeft();
-        textSpacing = m_xAxisRect.width() / m_iGridSizeY;
-        numStart = m_fXMin;
-        numSpacing = (m_fXMax - m_fXMin) / m_iGridSizeY;
+        if(left > 1)
+            break;
+        if(right < -1)
+            continue;
+
+        left = qMax(left, (float)-1);
+        right = qMin(right, (float)1);
+        if(!bands.isEmpty() && left <= bands.last())
+            bands.last() = qMax(bands.last(), right);
+        else
+            bands << left << right;
+    }
+}
+
+void GlGraphWidget::drawAxis()
+{
+    if(m_renderState.axisStyle == NoAxis)
+        return;
+
+    drawGridQuad(false, true);
+}
+
+void GlGraphWidget::drawGrid()
+{
+    if(m_xTicks.count == 0 && m_yTicks.count == 0)
+        return;
+
+    drawGridQuad(true, false);
+}
 
-        for(int i = 0; i <= m_iGridSizeY; i++)
+void GlGraphWidget::drawGridQuad(bool grid, bool axis)
+{
+    QRectF plotRect = PlotRectF();
+    if(plotRect.isEmpty())
+        return;
+
+    //Lines are generated in the fragment shader, the quad only has to cover
+    //the plot area plus the half of the axis line that lies outside it
+    static const GLfloat quad[] = { -1, -1,  1, -1,  -1, 1,  1, 1 };
+    float padding = qMax(m_renderState.axisLineWidth, m_renderState.gridLineWidth) + 1;
+    QMatrix4x4 quadTransform = m_renderState.transformMatrix;
+    quadTransform.scale(1 + (2 * padding / plotRect.width()), 1 + (2 * padding / plotRect.height()));
+
+    float axisSide = 0;
+    if(axis)
+        axisSide = (m_renderState.axisStyle == LeftAxis) ? -1 : 1;
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    //The shader works on gl_FragCoord, which is in device pixels
+    float ratio = m_renderState.pixelRatio;
+
+    m_gridShader->bind();
+    m_gridShader->setUniformValue("transform", quadTransform);
+    m_gridShader->setUniformValue("plotRect", QVector4D(plotRect.x() * ratio, plotRect.y() * ratio,
+                                                        plotRect.width() * ratio, plotRect.height() * ratio));
+    m_gridShader->setUniformValue("gridOrigin", QVector2D(m_xTicks.firstPixel * ratio, m_yTicks.firstPixel * ratio));
+    m_gridShader->setUniformValue("gridStep", QVector2D((grid && m_xTicks.count > 0) ? m_xTicks.pixelStep * ratio : 0,
+                                                        (grid && m_yTicks.count > 0) ? m_yTicks.pixelStep * ratio : 0));
+    m_gridShader->setUniformValue("gridWidth", m_renderState.gridLineWidth * ratio);
+    m_gridShader->setUniformValue("axisWidth", m_renderState.axisLineWidth * ratio);
+    m_gridShader->setUniformValue("axisSide", axisSide);
+    m_gridShader->setUniformValue("gridColor", m_renderState.gridColor);
+    m_gridShader->setUniformValue("axisColor", m_renderState.axisColor);
+    m_gridShader->enableAttributeArray("vertex");
+    m_gridShader->setAttributeArray("vertex", quad, 2, 0);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    m_gridShader->disableAttributeArray("vertex");
+    m_gridShader->release();
+
+    glDisable(GL_BLEND);
+}
+
+void GlGraphWidget::RenderRaster()
+{
+    //Same layout as the GL path, drawn into an image that paintEvent() puts
+    //on the screen as a single blit
+    const ViewState &state = m_renderState;
+    if(m_rasterImage.size() != state.size)
+        m_rasterImage = QImage(state.size, QImage::Format_RGB32);
+
+    m_rasterImage.fill(state.bgColor);
+    QRect plotRect = RasterPlotRect();
+
+    QPainter p(&m_rasterImage);
+    drawRasterGrid(p, plotRect, true, false);
+    drawRasterAlarms(p, plotRect);
+    if(state.displayMode == DensityMode)
+        drawRasterDensity(p, plotRect);
+    p.end();
+
+    //Written straight into the pixels, so no painter may be active
+    if(state.displayMode != DensityMode)
+        drawRasterLines(plotRect);
+
+    p.begin(&m_rasterImage);
+    drawRasterGrid(p, plotRect, false, true);
+    drawText(p);
+    p.end();
+}
+
+void GlGraphWidget::drawRasterLines(const QRect &plotRect)
+{
+    const ViewState &state = m_renderState;
+    if(plotRect.isEmpty() || state.yData.isEmpty())
+        return;
+
+    //Lines follow the sample index like the GL path, even for scatter data
+    QVector4D transform = PixelTransform(plotRect.size(), true);
+    m_lineRasterizer.draw(m_rasterImage, plotRect, state.yData.constData(), state.yData.size(),
+                          transform.x(), transform.y(), transform.z(), transform.w(),
+                          state.lineColor.rgb(), state.lineWidth);
+}
+
+void GlGraphWidget::drawRasterDensity(QPainter &p, const QRect &plotRect)
+{
+    if(plotRect.isEmpty() || m_renderState.yData.isEmpty())
+        return;
+
+    UpdateDensityMap(plotRect.size());
+
+    //The map is stored bottom row first for GL
+    QImage density(m_densityMap.pixels(), plotRect.width(), plotRect.height(), QImage::Format_RGBA8888);
+    p.drawImage(plotRect.topLeft(), density.mirrored());
+}
+
+void GlGraphWidget::drawRasterGrid(QPainter &p, const QRect &plotRect, bool grid, bool axis)
+{
+    const ViewState &state = m_renderState;
+    if(plotRect.isEmpty())
+        return;
+
+    //Tick positions are in GL window coordinates, y grows upwards
+    if(grid)
+    {
+        float width = state.gridLineWidth;
+        for(int i = 0; i < m_xTicks.count; i++)
         {
-            QString text = QString::number(numStart, 'f', 0);
-            QPoint drawPoint = textPos;
-            drawPoint.setX(drawPoint.x() - (metrics.width(text)/2));
+            float x = m_xTicks.firstPixel + (i * m_xTicks.pixelStep);
+            p.fillRect(QRectF(x - (width/2), plotRect.top(), width, plotRect.height()), state.gridColor);
+        }
 
-            p.drawText(drawPoint, text);
-            textPos.setX(textPos.x() + textSpacing);
-            numStart += numSpacing;
+        for(int i = 0; i < m_yTicks.count; i++)
+        {
+            float y = state.size.height() - (m_yTicks.firstPixel + (i * m_yTicks.pixelStep));
+            p.fillRect(QRectF(plotRect.left(), y - (width/2), plotRect.width(), width), state.gridColor);
         }
+    }
 
-        //p.fillRect(m_yAxisRect, QColor::fromRgb(255,0,0));
-        //p.fillRect(m_xAxisRect, QColor::fromRgb(255,0,0));
+    if(axis && state.axisStyle != NoAxis)
+    {
+        float width = state.axisLineWidth;
+        float x = (state.axisStyle == LeftAxis) ? plotRect.left() : plotRect.left() + plotRect.width();
+        float bottom = plotRect.top() + plotRect.height();
+
+        p.fillRect(QRectF(x - (width/2), plotRect.top(), width, plotRect.height() + (width/2)), state.axisColor);
+        p.fillRect(QRectF(plotRect.left() - (width/2), bottom - (width/2), plotRect.width() + width, width), state.axisColor);
+    }
+}
+
+void GlGraphWidget::drawRasterAlarms(QPainter &p, const QRect &plotRect)
+{
+    if(plotRect.isEmpty() || m_renderState.alarmSpans.isEmpty())
+        return;
+
+    AlarmBands(plotRect.width(), m_alarmBands);
+
+    float halfWidth = plotRect.width() / 2.0;
+    for(int i = 0; i + 1 < m_alarmBands.size(); i += 2)
+    {
+        float left = plotRect.left() + ((m_alarmBands[i] + 1) * halfWidth);
+        float right = plotRect.left() + ((m_alarmBands[i + 1] + 1) * halfWidth);
+        p.fillRect(QRectF(left, plotRect.top(), right - left, plotRect.height()), m_renderState.alarmColor);
     }
+}
 
+QRect GlGraphWidget::RasterPlotRect()
+{
+    //PlotRect() in image coordinates (origin top left)
+    QRect plotRect = PlotRect();
+    return QRect(plotRect.x(), m_renderState.size.height() - (plotRect.y() + plotRect.height()),
+                 plotRect.width(), plotRect.height());
+}
 
+void GlGraphWidget::drawText()
+{
+    QPainter p(m_surface);
+    p.beginNativePainting();
+    drawText(p);
     p.endNativePainting();
 }
 
-void GlGraphWidget::resizeGL(int width, int height)
+void GlGraphWidget::drawText(QPainter &p)
 {
-    //qDebug() << "resizeGL" << width << height;
-    glViewport(0,0, width, height);
-    UpdateMargins();
+    if(m_renderState.headerEnabled)
+    {
+        p.setFont(m_renderState.headerFont);
+        p.setPen(m_renderState.headerColor);
+        p.drawText(m_renderState.headerRect, Qt::AlignCenter, m_renderState.headerText);
+        //p.fillRect(m_renderState.headerRect, QColor::fromRgb(255,0,0));
+    }
+
+    if(m_renderState.footerEnabled)
+    {
+        p.setFont(m_renderState.footerFont);
+        p.setPen(m_renderState.footerColor);
+        p.drawText(m_renderState.footerRect, Qt::AlignLeft | Qt::AlignVCenter, m_renderState.footerText);
+        //p.fillRect(m_renderState.footerRect, QColor::fromRgb(255,0,0));
+    }
+
+    if(m_renderState.axisStyle != NoAxis)
+    {
+        //Layout or zoom changes always move the labels
+        if(m_iLabelLayoutSerial != m_renderState.layoutSerial || m_labelZoom != m_renderState.zoomMatrix)
+            m_bLayoutLabels = true;
+
+        //Labels are re-laid out every frame unless quality has been reduced
+        m_iFramesSinceLabelLayout++;
+        if(m_bLayoutLabels || m_quality.level() < QualityController::Minimal || m_iFramesSinceLabelLayout >= LABEL_LAYOUT_INTERVAL)
+            LayoutAxisLabels();
+
+        p.setFont(m_renderState.axisFont);
+        p.setPen(m_renderState.axisTextColor);
+
+        for(int i = 0; i < m_axisLabels.size(); i++)
+            p.drawStaticText(m_axisLabels[i].pos, m_axisLabels[i].text);
+
+        //p.fillRect(m_renderState.yAxisRect, QColor::fromRgb(255,0,0));
+        //p.fillRect(m_renderState.xAxisRect, QColor::fromRgb(255,0,0));
+    }
+}
+
+void GlGraphWidget::LayoutAxisLabels()
+{
+    m_bLayoutLabels = false;
+    m_iFramesSinceLabelLayout = 0;
+    m_iLabelLayoutSerial = m_renderState.layoutSerial;
+    m_labelZoom = m_renderState.zoomMatrix;
+    m_axisLabels.resize(0);
+
+    const QFont &font = m_renderState.axisFont;
+    QFontMetrics metrics(font);
+    int height = metrics.ascent() - metrics.descent();
+
+    //One label per grid line, with just enough decimals for the step
+    int decimals = 0;
+    if(m_yTicks.count > 0)
+        decimals = qMax(0, (int)-floor(log10(m_yTicks.step)));
+
+    AxisLabel label;
+    for(int i = 0; i < m_yTicks.count; i++)
+    {
+        float value = m_yTicks.first + (i * m_yTicks.step);
+        if(fabs(value) < m_yTicks.step * 0.001)
+            value = 0;
+
+        //Tick positions are in GL window coordinates, y grows upwards
+        float y = m_renderState.size.height() - (m_yTicks.firstPixel + (i * m_yTicks.pixelStep));
+
+        //Static text is positioned by its top left corner rather than the baseline
+        label.pos = QPointF(m_renderState.yAxisRect.left(), y + (height/2) - metrics.ascent());
+        label.text = QStaticText(QString::number(value, 'f', decimals));
+        label.text.prepare(QTransform(), font);
+        m_axisLabels.append(label);
+    }
+
+    // X AXIS
+    decimals = 0;
+    if(m_xTicks.count > 0)
+        decimals = qMax(0, (int)-floor(log10(m_xTicks.step)));
+
+    for(int i = 0; i < m_xTicks.count; i++)
+    {
+        float value = m_xTicks.first + (i * m_xTicks.step);
+        if(fabs(value) < m_xTicks.step * 0.001)
+            value = 0;
+
+        QString text = QString::number(value, 'f', decimals);
+        float x = m_xTicks.firstPixel + (i * m_xTicks.pixelStep);
+
+        label.pos = QPointF(x - (metrics.width(text)/2), m_renderState.xAxisRect.bottom() - metrics.ascent());
+        label.text = QStaticText(text);
+        label.text.prepare(QTransform(), font);
+        m_axisLabels.append(label);
+    }
 }
 
 void GlGraphWidget::mousePressEvent(QMouseEvent *event)
@@ -378,7 +1168,7 @@ void GlGraphWidget::mouseMoveEvent(QMouseEvent *event)
 void GlGraphWidget::mouseReleaseEvent(QMouseEvent *event)
 {
     QPointF pos((((float)event->pos().x()/width()) * 2.0) - 1.0,(((float)event->pos().y()/height()) * 2.0) - 1.0);
-    pos = m_transformMatrix.inverted().map(pos);
+    pos = m_state.transformMatrix.inverted().map(pos);
     //pos.setX(pos.x() * -1);
     pos.setY(pos.y() * -1);
     if(fabs((float)pos.x()) > 1 || fabs((float)pos.y()) >1)
@@ -400,99 +1190,219 @@ void GlGraphWidget::mouseReleaseEvent(QMouseEvent *event)
 
 float GlGraphWidget::getScaleFactor()
 {
-    float dataWidth = m_fMax - m_fMin;
-    float scaleWidth = m_fYMax - m_fYMin;
+    if(m_renderState.autoScale)
+        return YAxisScale(m_renderState.min, m_renderState.max);
+    else
+        return YAxisScale(m_renderState.yMin, m_renderState.yMax);
+}
 
-    if(m_bAutoScale)
-        return 2/dataWidth;
+void GlGraphWidget::getScaleFactors(float &first, float &second)
+{
+    if(m_renderState.autoScale)
+        YAxisScaleFactors(m_renderState.min, m_renderState.max, first, second);
     else
-        return 2/scaleWidth;
+        YAxisScaleFactors(m_renderState.yMin, m_renderState.yMax, first, second);
 }
 
 float GlGraphWidget::getYOffset()
 {
-    float scaleFactor = getScaleFactor();
-    float scaledMax = m_fYMax * scaleFactor;
-    float scaledMin = m_fYMin * scaleFactor;
+    if(m_renderState.autoScale)
+        return YAxisOffset(m_renderState.min, m_renderState.max);
+    else
+        return YAxisOffset(m_renderState.yMin, m_renderState.yMax);
+}
+
+void GlGraphWidget::getXRange(float &min, float &max)
+{
+    //Scatter data is mapped to its own extents while auto scaling. Only the
+    //density map plots X values, lines are still drawn by sample index.
+    const ViewState &state = m_renderState;
+    if(state.displayMode == DensityMode && !state.xData.isEmpty() &&
+       (state.autoScale || state.xMax <= state.xMin))
+    {
+        min = state.xDataMin;
+        max = state.xDataMax;
+        return;
+    }
+
+    //Without axis limits the X axis counts samples
+    if(state.xMax <= state.xMin)
+    {
+        min = 0;
+        max = qMax(1, state.sampleCount);
+        return;
+    }
+
+    min = state.xMin;
+    max = state.xMax;
+}
+
+int GlGraphWidget::getGridSizeX()
+{
+    if(m_quality.level() >= QualityController::Minimal && m_renderState.gridSizeX > 1)
+        return m_renderState.gridSizeX / 2;
+
+    return m_renderState.gridSizeX;
+}
+
+int GlGraphWidget::getGridSizeY()
+{
+    if(m_quality.level() >= QualityController::Minimal && m_renderState.gridSizeY > 1)
+        return m_renderState.gridSizeY / 2;
 
-    return (scaledMin + ((scaledMax - scaledMin) / 2.0)) * -1;
+    return m_renderState.gridSizeY;
 }
 
-void GlGraphWidget::UpdateGrid()
+void GlGraphWidget::CalculateTicks()
 {
-    m_bUpdateGridBuffer = true;
+    QRectF plotRect = PlotRectF();
+
+    //Visible part of the normalized [-1,1] graph space after zooming
+    const QMatrix4x4 &zoom = m_renderState.zoomMatrix;
+    float left = (-1 - zoom(0,3)) / zoom(0,0);
+    float right = (1 - zoom(0,3)) / zoom(0,0);
+    float bottom = (-1 - zoom(1,3)) / zoom(1,1);
+    float top = (1 - zoom(1,3)) / zoom(1,1);
+
+    //Back to data values with the same mapping the graph shader uses
+    float xMin, xMax;
+    getXRange(xMin, xMax);
+    float xScale = (xMax - xMin) / 2;
+    AxisTicks(xMin + ((left + 1) * xScale), xMin + ((right + 1) * xScale), getGridSizeX(),
+              plotRect.x(), plotRect.width(),
+              m_xTicks.first, m_xTicks.step, m_xTicks.count, m_xTicks.firstPixel, m_xTicks.pixelStep);
+
+    float yScale = getScaleFactor();
+    float yOffset = getYOffset();
+    AxisTicks((bottom - yOffset) / yScale, (top - yOffset) / yScale, getGridSizeY(),
+              plotRect.y(), plotRect.height(),
+              m_yTicks.first, m_yTicks.step, m_yTicks.count, m_yTicks.firstPixel, m_yTicks.pixelStep);
 }
 
-void GlGraphWidget::CreateGridBuffer()
+void GlGraphWidget::UpdateXAxisBuffer()
 {
-    if(!m_bUpdateGridBuffer)
+    int size = m_renderState.yData.size();
+    if(m_iXAxisBufferSize == size)
         return;
 
-    m_bUpdateGridBuffer = false;
+    //X axis buffers are shared between all graphs with the same sample count
+    GlGraphResources *resources = GlGraphResources::instance();
+    if(m_iXAxisBufferSize != 0)
+        resources->releaseXAxisBuffer(m_iXAxisBufferSize);
 
-    m_fvGridVBuffer.reserve(1024);
-    m_fvGridVBuffer.clear();
+    m_iXAxisBufferSize = size;
+    if(m_iXAxisBufferSize != 0)
+        m_xAxisBuffer = resources->acquireXAxisBuffer(m_iXAxisBufferSize);
+    else
+        m_xAxisBuffer = QGLBuffer();
+}
 
-    //Set up axis
-    if(m_axisStyle == LeftAxis)
+QVector4D GlGraphWidget::PixelTransform(const QSize &size, bool indexX)
+{
+    //Compose data -> normalized -> zoomed -> pixel into one scale and offset per axis
+    float xScale, xOffset;
+    if(indexX || m_renderState.xData.isEmpty())
     {
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(1);
-
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(1);
-        m_fvGridVBuffer.append(-1);
+        xScale = (float)2.0/(float)m_renderState.yData.size();
+        xOffset = -1.0 + xScale;
     }
-    else if(m_axisStyle == RightAxis)
+    else
     {
-        m_fvGridVBuffer.append(1);
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(1);
-        m_fvGridVBuffer.append(1);
-
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(1);
-        m_fvGridVBuffer.append(-1);
+        float xMin, xMax;
+        getXRange(xMin, xMax);
+        xScale = (xMax > xMin) ? (float)2.0/(xMax - xMin) : 0;
+        xOffset = -1.0 - (xMin * xScale);
     }
 
+    float yScale = getScaleFactor();
+    float yOffset = getYOffset();
+
+    float halfWidth = size.width() / 2.0;
+    float halfHeight = size.height() / 2.0;
+    QMatrix4x4 zoom = m_renderState.zoomMatrix * m_renderState.dataMatrix;
+    return QVector4D(xScale * zoom(0,0) * halfWidth,
+                     ((xOffset * zoom(0,0)) + zoom(0,3) + 1) * halfWidth,
+                     yScale * zoom(1,1) * halfHeight,
+                     ((yOffset * zoom(1,1)) + zoom(1,3) + 1) * halfHeight);
+}
 
+void GlGraphWidget::UpdateDensityMap(const QSize &size)
+{
+    QVector4D transform = PixelTransform(size, false);
 
-    if(m_iGridSizeX == 0 || m_iGridSizeY == 0)
+    bool colorMapChanged = m_densityColorMap != m_renderState.densityColorMap;
+    if(colorMapChanged)
     {
-        m_fvGridVBuffer.resize(8);
-        return;
+        m_densityColorMap = m_renderState.densityColorMap;
+        m_densityMap.setColorMap(m_densityColorMap);
     }
 
-    float gridWidth = 2.0/(float)m_iGridSizeX;
-    float gridHeight = 2.0/(float)m_iGridSizeY;
-    float startX = -1.0;
-    float startY = -1.0;
+    if(!colorMapChanged && m_iDensitySerial == m_renderState.dataSerial &&
+       size == m_densityMap.size() && transform == m_densityTransform)
+        return;
 
-    //X Grid Lines
-    for(int i = 0; i <= m_iGridSizeX; i++)
-    {
-        m_fvGridVBuffer.append(startX);
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(startX);
-        m_fvGridVBuffer.append(1);
+    m_iDensitySerial = m_renderState.dataSerial;
+    m_densityTransform = transform;
+    m_bDensityTextureStale = true;
+
+    const ViewState &state = m_renderState;
+    int count = state.yData.size();
+    m_densityMap.build(state.xData.isEmpty() ? 0 : state.xData.constData(), state.yData.constData(), count,
+                       transform.x(), transform.y(), transform.z(), transform.w(), size);
+}
 
-        startX += gridWidth;
+void GlGraphWidget::UpdateDensityTexture(const QRect &plotRect)
+{
+    QSize size = plotRect.size();
+    UpdateDensityMap(size);
+
+    if(!m_bDensityTextureStale && m_densityTexture != 0)
+        return;
+
+    m_bDensityTextureStale = false;
+
+    if(m_densityTexture == 0)
+    {
+        glGenTextures(1, &m_densityTexture);
+        glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, m_densityTexture);
     }
 
-    //Y Grid Lines
-    for(int i = 0; i <= m_iGridSizeY; i++)
+    if(size == m_densityTextureSize)
     {
-        m_fvGridVBuffer.append(-1);
-        m_fvGridVBuffer.append(startY);
-        m_fvGridVBuffer.append(1);
-        m_fvGridVBuffer.append(startY);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, m_densityMap.pixels());
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width(), size.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_densityMap.pixels());
+        m_densityTextureSize = size;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-        startY += gridHeight;
+void GlGraphWidget::StartSpectrumAnalyzer()
+{
+    if(m_spectrumThread)
+    {
+        QMetaObject::invokeMethod(m_spectrumAnalyzer, "reset", Qt::QueuedConnection);
+        return;
     }
+
+    m_spectrumAnalyzer = new SpectrumAnalyzer();
+    m_spectrumAnalyzer->setSettings(m_spectrumSettings);
+
+    m_spectrumThread = new QThread(this);
+    m_spectrumAnalyzer->moveToThread(m_spectrumThread);
+    connect(m_spectrumAnalyzer, SIGNAL(spectrumReady(SampleFrame)), this, SLOT(spectrumReady(SampleFrame)));
+    m_spectrumThread->start();
 }
 
 void GlGraphWidget::UpdateMargins()
@@ -502,55 +1412,64 @@ void GlGraphWidget::UpdateMargins()
 
 void GlGraphWidget::CalculateMargins()
 {
+    //Not part of the layout, the widget may move to another screen at any time
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    m_state.pixelRatio = devicePixelRatioF();
+#else
+    m_state.pixelRatio = devicePixelRatio();
+#endif
+
     if(!m_bRecalcMargins)
         return;
 
     m_bRecalcMargins = false;
+    m_state.layoutSerial++;
+    m_state.size = size();
 
-    m_transformMatrix.setToIdentity();
+    m_state.transformMatrix.setToIdentity();
 
     QMargins margins = m_margins;
 
-    if(m_bHeaderEnabled)
+    if(m_state.headerEnabled)
     {
-        QFontMetrics metrics(m_fntHeaderFont);
+        QFontMetrics metrics(m_state.headerFont);
         margins.setTop(margins.top() + metrics.height() + TEXT_MARGIN);
 
-        m_headerRect = QRect(m_margins.left(), m_margins.top(), width() - (m_margins.right() + m_margins.left()), metrics.height());
+        m_state.headerRect = QRect(m_margins.left(), m_margins.top(), width() - (m_margins.right() + m_margins.left()), metrics.height());
     }
 
-    if(m_bFooterEnabled)
+    if(m_state.footerEnabled)
     {
-        QFontMetrics metrics(m_fntFooterFont);
+        QFontMetrics metrics(m_state.footerFont);
         margins.setBottom(margins.bottom() + metrics.height() + TEXT_MARGIN);
 
-        m_footerRect = QRect(m_margins.left(), height() - (margins.bottom() - TEXT_MARGIN), width() - (m_margins.right() + m_margins.left()), metrics.height());
+        m_state.footerRect = QRect(m_margins.left(), height() - (margins.bottom() - TEXT_MARGIN), width() - (m_margins.right() + m_margins.left()), metrics.height());
     }
 
     //X axis
-    if(m_axisStyle != NoAxis)
+    if(m_state.axisStyle != NoAxis)
     {
-        QFontMetrics metrics(m_fntAxisFont);
+        QFontMetrics metrics(m_state.axisFont);
         margins.setBottom(margins.bottom() + metrics.height());
 
-        m_xAxisRect = QRect(m_margins.left(), height() - (margins.bottom()), width() - (m_margins.right() + m_margins.left()), metrics.height());
+        m_state.xAxisRect = QRect(m_margins.left(), height() - (margins.bottom()), width() - (m_margins.right() + m_margins.left()), metrics.height());
     }
 
-    if(m_axisStyle == LeftAxis)
+    if(m_state.axisStyle == LeftAxis)
     {
-        QFontMetrics metrics(m_fntAxisFont);
+        QFontMetrics metrics(m_state.axisFont);
         margins.setLeft(margins.left() + metrics.width("-0.0000") + TEXT_MARGIN);
 
-        m_yAxisRect = QRect(m_margins.left(), margins.top(), metrics.width("0.0000"), height() - (margins.top() + margins.bottom()));
-        m_xAxisRect.setLeft(margins.left());
+        m_state.yAxisRect = QRect(m_margins.left(), margins.top(), metrics.width("0.0000"), height() - (margins.top() + margins.bottom()));
+        m_state.xAxisRect.setLeft(margins.left());
     }
-    else if(m_axisStyle == RightAxis)
+    else if(m_state.axisStyle == RightAxis)
     {
-        QFontMetrics metrics(m_fntFooterFont);
+        QFontMetrics metrics(m_state.footerFont);
         margins.setRight(margins.right() + metrics.width("-0.0000") + TEXT_MARGIN);
 
-        m_yAxisRect = QRect(width() - (margins.right() - TEXT_MARGIN), margins.top(), metrics.width("0.0000"), height() - (margins.top() + margins.bottom()));
-        m_xAxisRect.setRight(margins.right());
+        m_state.yAxisRect = QRect(width() - (margins.right() - TEXT_MARGIN), margins.top(), metrics.width("0.0000"), height() - (margins.top() + margins.bottom()));
+        m_state.xAxisRect.setRight(margins.right());
     }
 
     QRect screen = QRect(QPoint(0,0), size());
@@ -560,8 +1479,37 @@ void GlGraphWidget::CalculateMargins()
     scale.setWidth((float)marginRect.width() / screen.width());
     scale.setHeight((float)marginRect.height() / screen.height());
 
-    m_transformMatrix.translate(translate.x(), translate.y());
-    m_transformMatrix.scale(scale.width(), scale.height());
+    m_state.transformMatrix.translate(translate.x(), translate.y());
+    m_state.transformMatrix.scale(scale.width(), scale.height());
+}
+
+QRect GlGraphWidget::PlotRect()
+{
+    QRectF plotRect = PlotRectF();
+    return QRect(plotRect.x(), plotRect.y(), plotRect.width(), plotRect.height());
+}
+
+QRect GlGraphWidget::DevicePlotRect()
+{
+    //Plot area in GL window pixels, as glScissor() takes it
+    QRectF plotRect = PlotRectF();
+    qreal ratio = m_renderState.pixelRatio;
+    return QRect(plotRect.x() * ratio, plotRect.y() * ratio, plotRect.width() * ratio, plotRect.height() * ratio);
+}
+
+QRectF GlGraphWidget::PlotRectF()
+{
+    //Plot area in GL window coordinates (origin bottom left)
+    float width = m_renderState.size.width();
+    float height = m_renderState.size.height();
+    QPointF bottomLeft = m_renderState.transformMatrix.map(QPointF(-1,-1));
+    QPointF topRight = m_renderState.transformMatrix.map(QPointF(1,1));
+    bottomLeft.setX((bottomLeft.x() + 1) * width/2);
+    bottomLeft.setY((bottomLeft.y() + 1) * height/2);
+    topRight.setX((topRight.x() + 1) * width/2);
+    topRight.setY((topRight.y() + 1) * height/2);
+
+    return QRectF(bottomLeft, QSizeF(topRight.x() - bottomLeft.x(), topRight.y() - bottomLeft.y()));
 }
 
 QPointF GlGraphWidget::ToScreenCoords(const QPointF &point)
@@ -574,62 +1522,201 @@ QPointF GlGraphWidget::ToScreenCoords(const QPointF &point)
 
 void GlGraphWidget::setHeaderText(const QString &text)
 {
-    m_sHeaderText = text;
-    m_bHeaderEnabled = !text.isEmpty();
+    m_state.headerText = text;
+    m_state.headerEnabled = !text.isEmpty();
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setHeaderFont(const QFont &font)
 {
-    m_fntHeaderFont = font;
+    m_state.headerFont = font;
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setHeaderColor(const QColor &color)
 {
-    m_cHeaderColor = color;
+    m_state.headerColor = color;
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setFooterText(const QString &text)
 {
-    m_sFooterText = text;
-    m_bFooterEnabled = !text.isEmpty();
+    m_state.footerText = text;
+    m_state.footerEnabled = !text.isEmpty();
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setFooterFont(const QFont &font)
 {
-    m_fntFooterFont = font;
+    m_state.footerFont = font;
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setFooterColor(const QColor &color)
 {
-    m_cFooterColor = color;
+    m_state.footerColor = color;
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setAxisFont(const QFont &font)
 {
-    m_fntAxisFont = font;
+    m_state.axisFont = font;
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setAxisTextColor(const QColor &color)
 {
-    m_cAxisTextColor = color;
+    m_state.axisTextColor = color;
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setMargins(int margin)
 {
     m_margins = QMargins(margin, margin, margin, margin);
     UpdateMargins();
+    StateChanged();
 }
 
 void GlGraphWidget::setMargins(int left, int top, int right, int bottom)
 {
     m_margins = QMargins(left, top, right, bottom);
     UpdateMargins();
+    StateChanged();
+}
+
+void GlGraphWidget::setQualityPolicy(const QualityController::Policy &policy)
+{
+    //Applied by the renderer, which emits qualityChanged() if the level moves
+    m_state.qualityPolicy = policy;
+    StateChanged();
+}
+
+void GlGraphWidget::setHistoryLength(int samples)
+{
+    m_history.setCapacity(samples);
+
+    if(samples > 0)
+        UpdateHistoryView();
+    else
+        SetDisplayData(SampleFrame());
+}
+
+void GlGraphWidget::setAlarmLimits(float low, float high)
+{
+    //Only samples from now on are checked
+    m_alarms.setLimits(low, high);
+    m_state.alarmSpans.clear();
+    StateChanged();
+}
+
+void GlGraphWidget::setAlarmColor(const QColor &color)
+{
+    m_state.alarmColor = color;
+    StateChanged();
+}
+
+int GlGraphWidget::alarmCount() const
+{
+    return m_alarms.eventCount();
+}
+
+void GlGraphWidget::setRenderBackend(RenderBackend backend)
+{
+    if(backend == m_state.renderBackend)
+        return;
+
+    //The render thread has to give the surface context back while it is
+    //created or hidden
+    GlGraphRenderThread *thread = m_renderThread;
+    if(thread)
+        setRenderThread(0);
+
+    m_state.renderBackend = backend;
+    if(backend == OpenGLBackend && isVisible())
+        CreateSurface();
+    if(m_surface)
+        m_surface->setVisible(backend == OpenGLBackend);
+
+    if(thread)
+        setRenderThread(thread);
+
+    update();
+    StateChanged();
+}
+
+GlGraphWidget::RenderBackend GlGraphWidget::renderBackend() const
+{
+    return m_state.renderBackend;
+}
+
+int GlGraphWidget::historyLength() const
+{
+    return m_history.capacity();
+}
+
+QualityController::Policy GlGraphWidget::qualityPolicy() const
+{
+    return m_state.qualityPolicy;
+}
+
+QualityController::Level GlGraphWidget::qualityLevel() const
+{
+    return (QualityController::Level)m_qualityLevel.load();
+}
+
+float GlGraphWidget::averageFrameTime() const
+{
+    return m_averageFrameTime.load() / 1000.0;
+}
+
+void GlGraphWidget::setRenderThread(GlGraphRenderThread *thread)
+{
+    if(thread == m_renderThread)
+        return;
+
+    bool threadedGL = (m_state.renderBackend == RasterBackend) || QOpenGLContext::supportsThreadedOpenGL();
+    if(thread && (!threadedGL || !QFontDatabase::supportsThreadedFontRendering()))
+    {
+        qWarning() << "GlGraphWidget: threaded rendering is not supported on this platform, rendering on the GUI thread";
+        thread = 0;
+
+        if(!m_renderThread)
+            return;
+    }
+
+    if(m_renderThread)
+    {
+        m_renderThread->removeWidget(this);
+        m_renderThread = 0;
+        m_frameRequested.store(0);
+
+        //The old thread's programs may be freed with it
+        m_programThread = 0;
+        StateChanged();
+    }
+
+    if(thread)
+    {
+        //The context is moved to the thread, so it has to exist first
+        if(m_state.renderBackend == OpenGLBackend)
+            CreateSurface();
+
+        m_programThread = 0;
+        m_renderThread = thread;
+        StateChanged();
+        thread->addWidget(this);
+    }
+}
+
+GlGraphRenderThread *GlGraphWidget::renderThread() const
+{
+    return m_renderThread;
 }
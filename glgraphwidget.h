@@ -1,12 +1,33 @@
 #ifndef GLGRAPHWIDGET_H
 #define GLGRAPHWIDGET_H
 
-#include <QGLWidget>
+#include <QWidget>
 #include <QGLShaderProgram>
+#include <QGLBuffer>
 #include <QColor>
 #include <QVector>
+#include <QVector4D>
+#include <QGradientStops>
+#include <QStaticText>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QImage>
+#include "densitymap.h"
+#include "spectrumanalyzer.h"
+#include "qualitycontroller.h"
+#include "triplebuffer.h"
+#include "framepool.h"
+#include "samplehistory.h"
+#include "linerasterizer.h"
+#include "alarmindex.h"
 
-class GlGraphWidget : public QGLWidget
+class QThread;
+class GlGraphRenderThread;
+class GlGraphSurface;
+
+//The OpenGL backend draws into a GlGraphSurface child window, the raster
+//backend paints the widget itself and never touches GL.
+class GlGraphWidget : public QWidget
 {
     Q_OBJECT
 public:
@@ -17,7 +38,21 @@ public:
         NoAxis
     };
 
+    enum DisplayMode
+    {
+        LineMode,
+        DensityMode,
+        SpectrumMode
+    };
+
+    enum RenderBackend
+    {
+        OpenGLBackend,
+        RasterBackend   //Drawn on the CPU into an image, for software or no GL
+    };
+
     explicit GlGraphWidget(QWidget *parent = 0);
+    ~GlGraphWidget();
 
     void setGridColor(const QColor &color);
     void setLineColor(const QColor &color);
@@ -27,13 +62,38 @@ public:
     void setGridLineWidth(float width);
 
     void setData(const QVector<float> &data);
+    //Takes a reference to the frame without copying the samples
+    void setData(const SampleFrame &frame);
+    void setScatterData(const QVector<float> &x, const QVector<float> &y);
     void setYAxisLimits(float min, float max);
     void setXAxisLimits(float min, float max);
     void setAutoScale(bool scale);
-    
+
+    //Keeps the last samples passed to setData() compressed and shows all of
+    //them instead of only the latest block. 0 (the default) turns it off.
+    void setHistoryLength(int samples);
+    int historyLength() const;
+
+    //Samples of later setData() calls that fall below low or above high are
+    //shaded over the trace, at least a pixel wide so single sample spikes stay
+    //visible when the line is decimated. low > high turns detection off.
+    void setAlarmLimits(float low, float high);
+    void setAlarmColor(const QColor &color);
+    //Alarms still within the shown data
+    int alarmCount() const;
+
     void setAxisStyle(AxisStyle style);
+    void setDisplayMode(DisplayMode mode);
+    DisplayMode displayMode() const;
+    void setDensityColorMap(const QGradientStops &stops);
+    void setSpectrumSettings(const SpectrumAnalyzer::Settings &settings);
     void setGridSize(int x, int y);
 
+    //Select the raster backend before the widget is first shown and no GL
+    //context is ever created
+    void setRenderBackend(RenderBackend backend);
+    RenderBackend renderBackend() const;
+
     void zoom(float zoomFactor, const QPointF &offset);
     void resetZoom();
     void setZoomStepSize(float stepSize);
@@ -50,78 +110,235 @@ public:
     void setMargins(int margin);
     void setMargins(int left, int top, int right, int bottom);
 
+    void setQualityPolicy(const QualityController::Policy &policy);
+    QualityController::Policy qualityPolicy() const;
+    QualityController::Level qualityLevel() const;
+    float averageFrameTime() const;
+
+    //Renders on the given thread instead of the GUI thread, 0 to go back.
+    //The same thread can be shared by several widgets.
+    void setRenderThread(GlGraphRenderThread *thread);
+    GlGraphRenderThread *renderThread() const;
+
+signals:
+    void qualityChanged(int level);
+
 protected:
-    virtual void initializeGL();
     virtual void paintEvent(QPaintEvent *event);
-    virtual void resizeGL(int width, int height);
+    virtual void resizeEvent(QResizeEvent *event);
+    virtual void showEvent(QShowEvent *event);
     virtual void mousePressEvent(QMouseEvent *event);
     virtual void mouseMoveEvent(QMouseEvent *event);
     virtual void mouseReleaseEvent(QMouseEvent *event);
-    
+
+private slots:
+    void spectrumReady(const SampleFrame &spectrum);
+
 private:
+    friend class GlGraphRenderThread;
+    friend class GlGraphSurface;
+
+    //Everything a frame is drawn from. The GUI thread owns m_state and hands
+    //copies to the renderer, which only ever reads m_renderState. Data frames
+    //and text are shared so a copy does not duplicate them.
+    struct ViewState
+    {
+        ViewState();
+
+        QColor axisColor;
+        QColor gridColor;
+        QColor lineColor;
+        QColor bgColor;
+        float axisLineWidth;
+        float gridLineWidth;
+        float lineWidth;
+
+        SampleFrame xData;
+        SampleFrame yData;
+        float xDataMin;
+        float xDataMax;
+        float min;
+        float max;
+        int sampleCount;        //Length of the X axis in samples, yData may only hold part of it
+        QMatrix4x4 dataMatrix;  //Places yData within those samples
+        QVector<float> alarmSpans;  //Start, end pairs of the visible alarms, in samples
+        QColor alarmColor;
+        float yMin;
+        float yMax;
+        float xMin;
+        float xMax;
+        bool autoScale;
+
+        int gridSizeX;
+        int gridSizeY;
+
+        AxisStyle axisStyle;
+        DisplayMode displayMode;
+        RenderBackend renderBackend;
+        QGradientStops densityColorMap;
+        QualityController::Policy qualityPolicy;
+
+        QMatrix4x4 zoomMatrix;
+
+        bool headerEnabled;
+        QString headerText;
+        QFont headerFont;
+        QColor headerColor;
+        bool footerEnabled;
+        QString footerText;
+        QFont footerFont;
+        QColor footerColor;
+        QFont axisFont;
+        QColor axisTextColor;
+
+        //Layout, calculated on the GUI thread by CalculateMargins(). Sizes
+        //are in logical pixels, GL windows are pixelRatio times larger.
+        QSize size;
+        qreal pixelRatio;
+        QMatrix4x4 transformMatrix;
+        QRect headerRect;
+        QRect footerRect;
+        QRect xAxisRect;
+        QRect yAxisRect;
+
+        //Bumped when the data or the layout changes
+        int dataSerial;
+        int layoutSerial;
+    };
+
+    void initializeGL();
+    void LoadPrograms();
+    void CreateSurface();
+    void SurfacePaint();
+    void RenderFrame();
+    void RenderThreadFrame();
+    void StateChanged();
+
     void drawAxis();
     void drawGrid();
+    void drawGridQuad(bool grid, bool axis);
+    void drawLines();
+    void drawDensity();
+    void drawAlarms();
     void drawText();
+    void drawText(QPainter &p);
+    void RenderRaster();
+    void drawRasterLines(const QRect &plotRect);
+    void drawRasterDensity(QPainter &p, const QRect &plotRect);
+    void drawRasterGrid(QPainter &p, const QRect &plotRect, bool grid, bool axis);
+    void drawRasterAlarms(QPainter &p, const QRect &plotRect);
+    void AlarmBands(float plotWidth, QVector<float> &bands);
+    QRect RasterPlotRect();
     float getScaleFactor();
+    //The scale as the graph shader takes it, see YAxisScaleFactors()
+    void getScaleFactors(float &first, float &second);
     float getYOffset();
-    void UpdateGrid();
-    void CreateGridBuffer();
+    void getXRange(float &min, float &max);
+    int getGridSizeX();
+    int getGridSizeY();
+    void CalculateTicks();
     void UpdateMargins();
     void CalculateMargins();
     QPointF ToScreenCoords(const QPointF &point);
+    QRect PlotRect();
+    QRect DevicePlotRect();
+    QRectF PlotRectF();
+    void UpdateXAxisBuffer();
+    QVector4D PixelTransform(const QSize &size, bool indexX);
+    void UpdateDensityMap(const QSize &size);
+    void UpdateDensityTexture(const QRect &plotRect);
+    void SetDisplayData(const SampleFrame &data);
+    SampleFrame AcquireFrame(FramePool &pool, int count);
+    SampleFrame CopyToFrame(FramePool &pool, const float *data, int count);
+    void UpdateHistoryView();
+    void DetectAlarms(const float *data, int count);
+    void UpdateAlarmSpans(int firstSample, int lastSample);
+    bool ReserveSpectrumBlock();
+    void QueueSpectrumBlock(const QVector<float> &data);
+    void QueueSpectrumBlock(const SampleFrame &data);
+    void StartSpectrumAnalyzer();
+    void LayoutAxisLabels();
+
+    //GUI thread
+    ViewState m_state;
+    QMargins m_margins;
+    float m_fZoomStepSize;
+    bool m_bRecalcMargins;
 
-    QGLShaderProgram m_gridShader;
-    QVector<float> m_fvGridVBuffer;
-    QGLShaderProgram m_graphShader;
-
-    QColor m_axisColor;
-    QColor m_gridColor;
-    QColor m_lineColor;
-    QColor m_bgColor;
-    float m_fAxisLineWidth;
-    float m_fGridLineWidth;
-    float m_fLineWidth;
-
-    QVector<float> m_xAxis;
-    QVector<float> m_yAxis;
-    float m_fMin;
-    float m_fMax;
-    float m_fYMin;
-    float m_fYMax;
-    float m_fXMin;
-    float m_fXMax;
-    bool m_bAutoScale;
+    QThread *m_spectrumThread;
+    SpectrumAnalyzer *m_spectrumAnalyzer;
+    SpectrumAnalyzer::Settings m_spectrumSettings;
+
+    //Frames still referenced by the states free the pool memory on release
+    FramePool m_framePool;
+    FramePool m_xFramePool;
+    SampleHistory m_history;
+    AlarmIndex m_alarms;
+
+    GlGraphRenderThread *m_renderThread;
+    TripleBuffer<ViewState> m_stateBuffer;
+    QAtomicInt m_frameRequested;
+    QAtomicInt m_qualityLevel;
+    QAtomicInt m_averageFrameTime;  //Microseconds
+
+    //Created on first use of the OpenGL backend
+    GlGraphSurface *m_surface;
+
+    //Thread that owns the GL context
+    ViewState m_renderState;
     bool m_bInitialized;
 
-    int m_iGridSizeX;
-    int m_iGridSizeY;
+    //Programs are per thread, these belong to m_programThread
+    QThread *m_programThread;
+    QGLShaderProgram *m_gridShader;
+    QGLShaderProgram *m_graphShader;
+    QGLBuffer m_xAxisBuffer;
+    int m_iXAxisBufferSize;
+    QGLShaderProgram *m_densityShader;
+    QGLShaderProgram *m_alarmShader;
+    GLuint m_densityTexture;
+    QSize m_densityTextureSize;
+    QVector<float> m_decimatedX;
+    QVector<float> m_decimatedY;
+    QVector<float> m_alarmBands;
+    QVector<float> m_alarmVertices;
 
-    AxisStyle m_axisStyle;
+    DensityMap m_densityMap;
+    QGradientStops m_densityColorMap;
+    QVector4D m_densityTransform;
+    int m_iDensitySerial;
+    bool m_bDensityTextureStale;
 
-    QMatrix4x4 m_transformMatrix;
-    QMatrix4x4 m_zoomMatrix;
-    float m_fZoomStepSize;
+    QImage m_rasterImage;
+    //Last image finished by the render thread, shown by paintEvent()
+    QImage m_presentedImage;
+    QMutex m_presentMutex;
+    LineRasterizer m_lineRasterizer;
 
-    bool m_bRecalcMargins;
-    bool m_bUpdateGridBuffer;
-
-    bool m_bHeaderEnabled;
-    QString m_sHeaderText;
-    QFont m_fntHeaderFont;
-    QColor m_cHeaderColor;
-    bool m_bFooterEnabled;
-    QString m_sFooterText;
-    QFont m_fntFooterFont;
-    QColor m_cFooterColor;
-    QFont m_fntAxisFont;
-    QColor m_cAxisTextColor;
-    QMargins m_margins;
+    QualityController m_quality;
 
-    QRect m_headerRect;
-    QRect m_footerRect;
-    QRect m_xAxisRect;
-    QRect m_yAxisRect;
+    //Grid lines and axis labels, recalculated every frame so they follow zoom
+    struct AxisTicks
+    {
+        float first;        //Value of the first visible tick
+        float step;         //Value between ticks
+        int count;
+        float firstPixel;   //Window position of the first tick (GL coordinates)
+        float pixelStep;
+    };
+    AxisTicks m_xTicks;
+    AxisTicks m_yTicks;
 
+    struct AxisLabel
+    {
+        QPointF pos;
+        QStaticText text;
+    };
+    QVector<AxisLabel> m_axisLabels;
+    bool m_bLayoutLabels;
+    int m_iFramesSinceLabelLayout;
+    int m_iLabelLayoutSerial;
+    QMatrix4x4 m_labelZoom;
 };
 
 #endif // GLGRAPHWIDGET_H
@@ -0,0 +1,100 @@
+#ifndef GRAPHDATAPROTOCOL_H
+#define GRAPHDATAPROTOCOL_H
+
+#include <QtGlobal>
+#include <QAtomicInt>
+#include <string.h>
+
+//Wire formats shared with the processes that feed SocketDataSource and
+//SharedMemoryDataSource. Both sides are on the same machine, so everything is
+//in host byte order.
+
+//Socket frames: a header followed by count float samples. A datagram or a
+//stream write may carry several frames back to back.
+#define GRAPH_FRAME_MAGIC 0x46475247u    //"GRGF"
+#define GRAPH_FRAME_MAX_SAMPLES (16 * 1024 * 1024)
+
+struct GraphFrameHeader
+{
+    quint32 magic;
+    quint32 sequence;   //Incremented per frame, gaps are counted as lost frames
+    quint32 count;
+    quint32 reserved;
+};
+
+//Shared memory ring: a GraphRingHeader followed by slotCount slots of
+//GraphRingSlotSize(slotCapacity) bytes. slotCount must be a power of two.
+//The producer writes frame n into slot n % slotCount: it sets the slot
+//sequence to 2n + 1, writes the samples and count, sets the sequence to
+//2n + 2 and finally publishes writeCount = n + 1. A reader that finds a
+//different sequence before or after copying a slot knows it was overwritten.
+#define GRAPH_RING_MAGIC 0x474e5247u     //"GRNG"
+
+struct GraphRingHeader
+{
+    quint32 magic;
+    quint32 slotCount;
+    quint32 slotCapacity;   //Samples per slot
+    quint32 reserved;
+    QAtomicInt writeCount;
+};
+
+struct GraphRingSlot
+{
+    QAtomicInt sequence;
+    quint32 count;
+    //float samples[slotCapacity] follow
+};
+
+inline size_t GraphRingSlotSize(quint32 slotCapacity)
+{
+    //Keeps every slot 8 byte aligned
+    return (sizeof(GraphRingSlot) + (slotCapacity * sizeof(float)) + 7) & ~(size_t)7;
+}
+
+inline size_t GraphRingSize(quint32 slotCount, quint32 slotCapacity)
+{
+    return ((sizeof(GraphRingHeader) + 7) & ~(size_t)7) + (slotCount * GraphRingSlotSize(slotCapacity));
+}
+
+//The geometry is passed in rather than read from the header, so a reader can
+//use the values it validated instead of ones the producer may still change
+inline GraphRingSlot *GraphRingSlotAt(GraphRingHeader *header, quint32 slotCount, quint32 slotCapacity, quint32 frame)
+{
+    char *slots = (char *)header + ((sizeof(GraphRingHeader) + 7) & ~(size_t)7);
+    return (GraphRingSlot *)(slots + ((frame & (slotCount - 1)) * GraphRingSlotSize(slotCapacity)));
+}
+
+inline const GraphRingSlot *GraphRingSlotAt(const GraphRingHeader *header, quint32 slotCount, quint32 slotCapacity, quint32 frame)
+{
+    return GraphRingSlotAt(const_cast<GraphRingHeader *>(header), slotCount, slotCapacity, frame);
+}
+
+inline float *GraphRingSamples(GraphRingSlot *slot)
+{
+    return (float *)(slot + 1);
+}
+
+inline const float *GraphRingSamples(const GraphRingSlot *slot)
+{
+    return (const float *)(slot + 1);
+}
+
+//Producer side of the ring, for processes that link against Qt
+inline void GraphRingWrite(GraphRingHeader *header, const float *data, quint32 count)
+{
+    quint32 slotCapacity = header->slotCapacity;
+    quint32 frame = header->writeCount.load();
+    GraphRingSlot *slot = GraphRingSlotAt(header, header->slotCount, slotCapacity, frame);
+    count = qMin(count, slotCapacity);
+
+    //Ordered so the samples cannot be seen changing before the odd sequence
+    slot->sequence.fetchAndStoreOrdered((frame * 2) + 1);
+    memcpy(GraphRingSamples(slot), data, count * sizeof(float));
+    slot->count = count;
+    slot->sequence.storeRelease((frame * 2) + 2);
+
+    header->writeCount.storeRelease(frame + 1);
+}
+
+#endif // GRAPHDATAPROTOCOL_H
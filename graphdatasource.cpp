@@ -0,0 +1,105 @@
+#include "graphdatasource.h"
+#include "glgraphwidget.h"
+
+//More than the graph can hold at once, see GlGraphWidget
+#define FRAME_POOL_SIZE 8
+
+GraphDataSource::GraphDataSource(GlGraphWidget *graph, QObject *parent)
+    : QObject(parent)
+    , m_graph(graph)
+    , m_framePool(0, FRAME_POOL_SIZE)
+    , m_iReceived(0)
+    , m_iDropped(0)
+    , m_iLost(0)
+    , m_iLastSequence(0)
+    , m_bHaveSequence(false)
+{
+}
+
+GraphDataSource::~GraphDataSource()
+{
+}
+
+GlGraphWidget *GraphDataSource::graph() const
+{
+    return m_graph;
+}
+
+QString GraphDataSource::errorString() const
+{
+    return m_sError;
+}
+
+void GraphDataSource::setErrorString(const QString &error)
+{
+    m_sError = error;
+}
+
+quint64 GraphDataSource::receivedFrames() const
+{
+    return m_iReceived;
+}
+
+quint64 GraphDataSource::droppedFrames() const
+{
+    return m_iDropped;
+}
+
+quint64 GraphDataSource::lostFrames() const
+{
+    return m_iLost;
+}
+
+void GraphDataSource::resetCounters()
+{
+    m_iReceived = 0;
+    m_iDropped = 0;
+    m_iLost = 0;
+    m_bHaveSequence = false;
+}
+
+bool GraphDataSource::everyFrame() const
+{
+    //The spectrum analyzer joins blocks into one continuous signal, skipping
+    //some would put discontinuities into the FFT input
+    return m_graph->historyLength() > 0 || m_graph->displayMode() == GlGraphWidget::SpectrumMode;
+}
+
+void GraphDataSource::frameArrived(quint32 sequence)
+{
+    m_iReceived++;
+
+    //Sequences that go backwards mean the producer restarted, not a gap
+    quint32 gap = sequence - (m_iLastSequence + 1);
+    if(m_bHaveSequence && gap < 0x80000000u)
+        m_iLost += gap;
+
+    m_iLastSequence = sequence;
+    m_bHaveSequence = true;
+}
+
+void GraphDataSource::dropFrames(int count)
+{
+    m_iDropped += count;
+}
+
+SampleFrame GraphDataSource::acquireFrame(int count)
+{
+    m_framePool.ensureCapacity(count);
+
+    SampleFrame frame = m_framePool.acquire();
+    if(frame.isNull())
+    {
+        //The graph is not keeping up, back off rather than allocate
+        m_iDropped++;
+        return frame;
+    }
+
+    frame.resize(count);
+    return frame;
+}
+
+void GraphDataSource::deliver(const SampleFrame &frame)
+{
+    m_graph->setData(frame);
+}
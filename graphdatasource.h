@@ -0,0 +1,61 @@
+#ifndef GRAPHDATASOURCE_H
+#define GRAPHDATASOURCE_H
+
+#include <QObject>
+#include <QString>
+#include "framepool.h"
+
+class GlGraphWidget;
+
+//Base of the sources that feed a GlGraphWidget straight from another process.
+//Every frame read in one go is a batch: with a history or in spectrum mode
+//every frame of it is passed on, otherwise only the newest one is shown and
+//the rest count as dropped. The shared memory ring is copied once, straight into a pooled frame
+//the graph takes over without copying. Sockets are read into one staging
+//buffer per batch first, since a datagram may hold several frames.
+class GraphDataSource : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GraphDataSource(GlGraphWidget *graph, QObject *parent = 0);
+    ~GraphDataSource();
+
+    GlGraphWidget *graph() const;
+    QString errorString() const;
+
+    //Frames that arrived intact
+    quint64 receivedFrames() const;
+    //Frames that arrived but were never shown, because a newer frame of the
+    //same batch replaced them or because the graph still held every frame
+    quint64 droppedFrames() const;
+    //Frames that never arrived, from sequence gaps or overwritten ring slots
+    quint64 lostFrames() const;
+    void resetCounters();
+
+protected:
+    void setErrorString(const QString &error);
+
+    //True if the graph needs every frame, because it keeps a history or
+    //analyzes the spectrum of the continuous signal
+    bool everyFrame() const;
+    //Accounts for a frame, sequences are expected to count up by one
+    void frameArrived(quint32 sequence);
+    void dropFrames(int count);
+
+    //Returns a null frame, counted as dropped, when the graph holds them all
+    SampleFrame acquireFrame(int count);
+    void deliver(const SampleFrame &frame);
+
+private:
+    GlGraphWidget *m_graph;
+    FramePool m_framePool;
+    QString m_sError;
+
+    quint64 m_iReceived;
+    quint64 m_iDropped;
+    quint64 m_iLost;
+    quint32 m_iLastSequence;
+    bool m_bHaveSequence;
+};
+
+#endif // GRAPHDATASOURCE_H
@@ -0,0 +1,271 @@
+#include "graphkernels.h"
+#include "math.h"
+
+#define EXCURSION_BLOCK_SIZE 64
+#define MAX_AXIS_TICKS 1000
+
+void FindExtents(const float *data, int count, float &min, float &max)
+{
+    //Seeded from the first real sample, a NaN seed would fail every compare
+    int i = 0;
+    while(i < count && data[i] != data[i])
+        i++;
+
+    if(i == count)
+    {
+        min = 0;
+        max = 0;
+        return;
+    }
+
+    min = data[i];
+    max = data[i];
+
+    //Comparisons with NaN are false, so the rest skip it by themselves
+    for(i++; i < count; i++)
+    {
+        float tmp = data[i];
+        if(tmp < min)
+            min = tmp;
+        if(tmp > max)
+            max = tmp;
+    }
+}
+
+void FillXAxis(float *x, int count)
+{
+    //Accumulated rather than multiplied, the spacing the graph has always used
+    float curX = -1.0;
+    float stepSize = (float)2.0/(float)count;
+
+    for(int i = 0; i < count; i++)
+    {
+        curX += stepSize;
+        x[i] = curX;
+    }
+}
+
+static double YAxisRange(float min, float max)
+{
+    //Equal limits, e.g. a flat line auto scaled, are centred on the value
+    //with a range of 2 rather than divided by zero
+    double range = (double)max - (double)min;
+    return (range != 0) ? range : 2.0;
+}
+
+float YAxisScale(float min, float max)
+{
+    return 2.0 / YAxisRange(min, max);
+}
+
+void YAxisScaleFactors(float min, float max, float &first, float &second)
+{
+    //Square roots of anything from the smallest to the largest scale a float
+    //range can give are well within the normal range
+    double scale = 2.0 / YAxisRange(min, max);
+    double root = sqrt(scale);
+    first = root;
+    second = scale / root;
+}
+
+float YAxisOffset(float min, float max)
+{
+    double scaleFactor = 2.0 / YAxisRange(min, max);
+    double scaledMax = max * scaleFactor;
+    double scaledMin = min * scaleFactor;
+
+    return (scaledMin + ((scaledMax - scaledMin) / 2.0)) * -1;
+}
+
+void BinPoints(const float *x, const float *y, int count,
+               float xScale, float xOffset, float yScale, float yOffset,
+               int width, int height, unsigned int *bins)
+{
+    for(int i = 0; i < count; i++)
+    {
+        float xValue = x ? x[i] : (float)i;
+        float binX = (xValue * xScale) + xOffset;
+        float binY = (y[i] * yScale) + yOffset;
+
+        //Written so NaN fails the test as well
+        if(!(binX >= 0 && binX < width && binY >= 0 && binY < height))
+            continue;
+
+        bins[((int)binY * width) + (int)binX]++;
+    }
+}
+
+int DecimateMinMax(const float *data, int count, int columns, float *x, float *y)
+{
+    float step = (float)2.0/(float)count;
+    int points = 0;
+
+    for(int column = 0; column < columns; column++)
+    {
+        int start = (int)(((double)column * count) / columns);
+        int end = (int)(((double)(column + 1) * count) / columns);
+        if(end <= start)
+            continue;
+
+        int minIndex = start;
+        int maxIndex = start;
+        for(int i = start + 1; i < end; i++)
+        {
+            if(data[i] < data[minIndex])
+                minIndex = i;
+            if(data[i] > data[maxIndex])
+                maxIndex = i;
+        }
+
+        int first = minIndex < maxIndex ? minIndex : maxIndex;
+        int second = minIndex < maxIndex ? maxIndex : minIndex;
+
+        //Same spacing as the shared X axis buffer
+        x[points] = -1.0 + ((first + 1) * step);
+        y[points++] = data[first];
+        x[points] = -1.0 + ((second + 1) * step);
+        y[points++] = data[second];
+    }
+
+    return points;
+}
+
+void LineSpans(const float *y, int count, float xScale, float xOffset,
+               float yScale, float yOffset, int columns, float *lo, float *hi)
+{
+    for(int column = 0; column < columns; column++)
+    {
+        lo[column] = 1;
+        hi[column] = 0;
+    }
+
+    if(count <= 0 || columns <= 0 || !(xScale > 0))
+        return;
+
+    float x0 = xOffset;
+    float y0 = (y[0] * yScale) + yOffset;
+    if(count == 1 && x0 >= 0 && x0 < columns)
+        lo[(int)x0] = hi[(int)x0] = y0;
+
+    for(int i = 1; i < count; i++)
+    {
+        float x1 = (i * xScale) + xOffset;
+        float y1 = (y[i] * yScale) + yOffset;
+
+        //Written so NaN fails the test as well
+        if(x1 >= 0 && x0 < columns && x1 > x0 && y0 == y0 && y1 == y1)
+        {
+            float slope = (y1 - y0) / (x1 - x0);
+            int first = (x0 > 0) ? (int)x0 : 0;
+            int last = (x1 < columns) ? (int)x1 : columns - 1;
+
+            //Many samples per column is the common case, each segment then only
+            //touches one column
+            for(int column = first; column <= last; column++)
+            {
+                float xa = (x0 > column) ? x0 : column;
+                float xb = (x1 < column + 1) ? x1 : column + 1;
+                float ya = y0 + ((xa - x0) * slope);
+                float yb = y0 + ((xb - x0) * slope);
+                float low = (ya < yb) ? ya : yb;
+                float high = (ya < yb) ? yb : ya;
+
+                if(lo[column] > hi[column])
+                {
+                    lo[column] = low;
+                    hi[column] = high;
+                }
+                else
+                {
+                    if(low < lo[column])
+                        lo[column] = low;
+                    if(high > hi[column])
+                        hi[column] = high;
+                }
+            }
+        }
+
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+void FillSpans(const int *top, const int *bottom, int columns, int firstRow, int lastRow,
+               unsigned int color, unsigned int *pixels, int stride)
+{
+    for(int row = firstRow; row < lastRow; row++)
+    {
+        unsigned int *line = pixels + ((long)row * stride);
+        for(int column = 0; column < columns; column++)
+            line[column] = (top[column] <= row && row <= bottom[column]) ? color : line[column];
+    }
+}
+
+int FindExcursions(const float *data, int count, float low, float high, bool &outside, int *edges)
+{
+    int state = outside ? 1 : 0;
+    int edgeCount = 0;
+
+    for(int start = 0; start < count; start += EXCURSION_BLOCK_SIZE)
+    {
+        int end = (count - start > EXCURSION_BLOCK_SIZE) ? start + EXCURSION_BLOCK_SIZE : count;
+
+        //Limits are rarely crossed, so most blocks stop here
+        int changed = 0;
+        for(int i = start; i < end; i++)
+            changed |= ((data[i] < low) | (data[i] > high)) ^ state;
+
+        if(!changed)
+            continue;
+
+        for(int i = start; i < end; i++)
+        {
+            int value = (data[i] < low) | (data[i] > high);
+            if(value != state)
+            {
+                edges[edgeCount++] = i;
+                state = value;
+            }
+        }
+    }
+
+    outside = (state != 0);
+    return edgeCount;
+}
+
+float NiceStep(double range, int divisions)
+{
+    //Also rejects NaN
+    if(!(range > 0) || divisions <= 0)
+        return 0;
+
+    double rawStep = range / divisions;
+    double magnitude = pow(10.0, floor(log10(rawStep)));
+    double normalized = rawStep / magnitude;
+
+    if(normalized < 1.5)
+        return magnitude;
+    if(normalized < 3)
+        return 2 * magnitude;
+    if(normalized < 7)
+        return 5 * magnitude;
+
+    return 10 * magnitude;
+}
+
+void AxisTicks(float min, float max, int divisions, float start, float length,
+               float &first, float &step, int &count, float &firstPixel, float &pixelStep)
+{
+    count = 0;
+    double range = (double)max - (double)min;
+    step = NiceStep(range, divisions);
+    if(step == 0 || length <= 0)
+        return;
+
+    double firstValue = ceil(min / (double)step) * step;
+    double ticks = floor((max - firstValue) / step) + 1;
+    count = (ticks < MAX_AXIS_TICKS) ? (int)ticks : MAX_AXIS_TICKS;
+    first = firstValue;
+    pixelStep = (step / range) * length;
+    firstPixel = start + (((firstValue - min) / range) * length);
+}
@@ -0,0 +1,73 @@
+#ifndef GRAPHKERNELS_H
+#define GRAPHKERNELS_H
+
+//Per-sample kernels used by the graph data path. These only work on plain
+//arrays so they can be split across threads and timed on their own.
+
+//Smallest and largest value in data, count must be greater than zero. NaN
+//samples are skipped, if every sample is NaN both are 0.
+void FindExtents(const float *data, int count, float &min, float &max);
+
+//X axis shared by every graph of count samples, x[i] = -1 + (i + 1) * (2 / count)
+void FillXAxis(float *x, int count);
+
+//Scale and offset that map [min, max] onto [-1, 1]. Calculated in double so
+//max - min cannot overflow, but limits further apart than FLT_MAX still give a
+//subnormal scale. Equal limits get a range of 2 centred on the value.
+float YAxisScale(float min, float max);
+float YAxisOffset(float min, float max);
+
+//The same scale split into two factors that are each a normal float, for the
+//graph shader. GPUs may flush a subnormal uniform to zero.
+void YAxisScaleFactors(float min, float max, float &first, float &second);
+
+//Accumulates points into a width x height histogram, row 0 is the bottom of
+//the plot. The bin of a point is (x * xScale + xOffset, y * yScale + yOffset),
+//points that fall outside the histogram are dropped. If x is null the sample
+//index is used as the x value.
+void BinPoints(const float *x, const float *y, int count,
+               float xScale, float xOffset, float yScale, float yOffset,
+               int width, int height, unsigned int *bins);
+
+//Reduces data to the minimum and maximum of each of columns equal ranges, in
+//the order they occur, so a line strip through the result covers the same
+//vertical extent as the full data. x receives the normalized [-1,1] position
+//of each kept sample. x and y must hold 2 * columns values, returns the number
+//of points written.
+int DecimateMinMax(const float *data, int count, int columns, float *x, float *y);
+
+//Rasterizes the line strip through (i * xScale + xOffset, y[i] * yScale + yOffset)
+//into one vertical span per pixel column, in pixels from the bottom left. lo and
+//hi receive the lowest and highest point of the line within each of columns
+//columns, lo is greater than hi for columns the line does not cross.
+void LineSpans(const float *y, int count, float xScale, float xOffset,
+               float yScale, float yOffset, int columns, float *lo, float *hi);
+
+//Sets the pixels of rows [firstRow, lastRow) that lie within the span of their
+//column, [top, bottom] inclusive, to color. pixels is the first column of row 0
+//and stride the distance between rows, both in pixels. Written without
+//branches so the inner loop vectorizes.
+void FillSpans(const int *top, const int *bottom, int columns, int firstRow, int lastRow,
+               unsigned int color, unsigned int *pixels, int stride);
+
+//Finds where data leaves and re-enters [low, high]. outside is the state before
+//data[0] and receives the state after the last sample. The index of every
+//sample at which the state changes is written to edges, which must hold count
+//values, returns the number of edges. NaN counts as inside. Blocks without an
+//edge are rejected with a branch free test that vectorizes.
+int FindExcursions(const float *data, int count, float low, float high, bool &outside, int *edges);
+
+//A 1, 2 or 5 times power of ten step that splits range into roughly divisions
+//intervals. Returns 0 if range or divisions is not positive, or if the step
+//is too small for a float. The range is a double so the span of the whole
+//float range does not overflow.
+float NiceStep(double range, int divisions);
+
+//Grid lines at NiceStep() intervals over [min, max], which is drawn over
+//length pixels from start: count lines step apart from the value first, the
+//first of them at firstPixel and the others pixelStep apart. count is 0 if
+//there is nothing to draw.
+void AxisTicks(float min, float max, int divisions, float start, float length,
+               float &first, float &step, int &count, float &firstPixel, float &pixelStep);
+
+#endif // GRAPHKERNELS_H
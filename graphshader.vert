@@ -1,12 +1,12 @@
 #version 120
 attribute float xAxis;
 attribute float yAxis;
-uniform float scaleFactor;
+uniform vec2 scaleFactor;
 uniform float yOffset;
 uniform mat4 transform;
 uniform mat4 zoom;
 
 void main(void)
 {
-    gl_Position = transform * zoom * vec4(xAxis, (yAxis * scaleFactor) + yOffset, 0.0, 1.0);
+    gl_Position = transform * zoom * vec4(xAxis, (yAxis * scaleFactor.x * scaleFactor.y) + yOffset, 0.0, 1.0);
 }
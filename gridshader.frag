@@ -1,6 +1,57 @@
-uniform vec4 lineColor;
+uniform vec4 plotRect;      //x, y, width, height in window pixels
+uniform vec2 gridOrigin;    //Window position of one grid line on each axis
+uniform vec2 gridStep;      //Pixels between grid lines, 0 for none
+uniform float gridWidth;
+uniform float axisWidth;
+uniform float axisSide;     //-1 left, 1 right, 0 no axis
+uniform vec4 gridColor;
+uniform vec4 axisColor;
+
+//Coverage of a pixel whose centre is distance pixels away from a line
+float lineCoverage(float distance, float width)
+{
+    return clamp((width * 0.5) + 0.5 - distance, 0.0, 1.0);
+}
+
+//Distance to the nearest of a set of evenly spaced lines
+float gridDistance(float pos, float origin, float step)
+{
+    float offset = mod(pos - origin, step);
+    return min(offset, step - offset);
+}
 
 void main(void)
 {
-    gl_FragColor = lineColor;
+    vec2 pos = gl_FragCoord.xy;
+    vec2 plotMin = plotRect.xy;
+    vec2 plotMax = plotRect.xy + plotRect.zw;
+
+    float grid = 0.0;
+    if(pos.x >= plotMin.x && pos.x <= plotMax.x && pos.y >= plotMin.y && pos.y <= plotMax.y)
+    {
+        if(gridStep.x > 0.0)
+            grid = max(grid, lineCoverage(gridDistance(pos.x, gridOrigin.x, gridStep.x), gridWidth));
+        if(gridStep.y > 0.0)
+            grid = max(grid, lineCoverage(gridDistance(pos.y, gridOrigin.y, gridStep.y), gridWidth));
+    }
+
+    float axis = 0.0;
+    if(axisSide != 0.0)
+    {
+        float halfWidth = axisWidth * 0.5;
+        float axisX = axisSide < 0.0 ? plotMin.x : plotMax.x;
+
+        if(pos.y >= plotMin.y - halfWidth && pos.y <= plotMax.y + halfWidth)
+            axis = max(axis, lineCoverage(abs(pos.x - axisX), axisWidth));
+        if(pos.x >= plotMin.x - halfWidth && pos.x <= plotMax.x + halfWidth)
+            axis = max(axis, lineCoverage(abs(pos.y - plotMin.y), axisWidth));
+    }
+
+    vec4 color = vec4(gridColor.rgb, gridColor.a * grid);
+    color = vec4(mix(color.rgb, axisColor.rgb, axis), max(color.a, axisColor.a * axis));
+
+    if(color.a <= 0.0)
+        discard;
+
+    gl_FragColor = color;
 }
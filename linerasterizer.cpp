@@ -0,0 +1,106 @@
+#include "linerasterizer.h"
+#include "graphkernels.h"
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrentRun>
+#include "math.h"
+
+#define MIN_PIXELS_PER_THREAD 65536
+
+namespace
+{
+    struct RowBand
+    {
+        const int *top;
+        const int *bottom;
+        int columns;
+        int firstRow;
+        int lastRow;
+        unsigned int color;
+        unsigned int *pixels;
+        int stride;
+    };
+
+    void FillBand(RowBand *band)
+    {
+        FillSpans(band->top, band->bottom, band->columns, band->firstRow, band->lastRow,
+                  band->color, band->pixels, band->stride);
+    }
+}
+
+LineRasterizer::LineRasterizer()
+{
+}
+
+void LineRasterizer::draw(QImage &image, const QRect &rect, const float *y, int count,
+                          float xScale, float xOffset, float yScale, float yOffset,
+                          QRgb color, float width)
+{
+    QRect clip = rect & image.rect();
+    if(clip.isEmpty() || count <= 0)
+        return;
+
+    //Spans are calculated for the whole rect and clipped when filling
+    int columns = rect.width();
+    int rows = rect.height();
+    m_lo.resize(columns);
+    m_hi.resize(columns);
+    m_top.resize(columns);
+    m_bottom.resize(columns);
+
+    LineSpans(y, count, xScale, xOffset, yScale, yOffset, columns, m_lo.data(), m_hi.data());
+
+    //Thick lines grow the span vertically and merge it with its neighbours
+    float halfWidth = qMax((float)0, (width - 1) / 2);
+    int reach = (int)(halfWidth + 0.5);
+
+    for(int column = 0; column < columns; column++)
+    {
+        int top = rows;
+        int bottom = -1;
+        for(int i = qMax(0, column - reach); i <= qMin(columns - 1, column + reach); i++)
+        {
+            if(m_lo[i] > m_hi[i])
+                continue;
+
+            //Spans count rows from the bottom, the image from the top
+            top = qMin(top, rows - 1 - (int)floor(m_hi[i] + halfWidth));
+            bottom = qMax(bottom, rows - 1 - (int)floor(m_lo[i] - halfWidth));
+        }
+
+        //Rows relative to the top of the clipped area
+        m_top[column] = top - (clip.top() - rect.top());
+        m_bottom[column] = bottom - (clip.top() - rect.top());
+    }
+
+    int firstColumn = clip.left() - rect.left();
+    int stride = image.bytesPerLine() / sizeof(unsigned int);
+    unsigned int *pixels = (unsigned int *)image.scanLine(clip.top()) + clip.left();
+
+    int rowCount = clip.height();
+    int threads = qBound(1, (rowCount * clip.width()) / MIN_PIXELS_PER_THREAD, QThread::idealThreadCount());
+    int rowsPerBand = (rowCount + threads - 1) / threads;
+
+    QVector<RowBand> bands(threads);
+    for(int i = 0; i < threads; i++)
+    {
+        RowBand &band = bands[i];
+        band.top = m_top.constData() + firstColumn;
+        band.bottom = m_bottom.constData() + firstColumn;
+        band.columns = clip.width();
+        band.firstRow = i * rowsPerBand;
+        band.lastRow = qMin(rowCount, band.firstRow + rowsPerBand);
+        band.color = 0xff000000 | color;
+        band.pixels = pixels;
+        band.stride = stride;
+    }
+
+    QVector<QFuture<void> > futures;
+    for(int i = 1; i < threads; i++)
+        futures.append(QtConcurrent::run(FillBand, &bands[i]));
+
+    FillBand(&bands[0]);
+
+    for(int i = 0; i < futures.size(); i++)
+        futures[i].waitForFinished();
+}
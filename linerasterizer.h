@@ -0,0 +1,32 @@
+#ifndef LINERASTERIZER_H
+#define LINERASTERIZER_H
+
+#include <QVector>
+#include <QImage>
+#include <QRect>
+#include <QRgb>
+
+//Draws a trace into a QImage without GL. The line is first reduced to one
+//vertical span per pixel column, then the spans are filled a band of rows per
+//thread, so the cost is the number of samples plus the plot area no matter how
+//dense the data is.
+class LineRasterizer
+{
+public:
+    LineRasterizer();
+
+    //Draws the line strip through (i * xScale + xOffset, y[i] * yScale + yOffset),
+    //in pixels from the bottom left of rect, clipped to rect. image must be
+    //Format_RGB32 or Format_ARGB32_Premultiplied.
+    void draw(QImage &image, const QRect &rect, const float *y, int count,
+              float xScale, float xOffset, float yScale, float yOffset,
+              QRgb color, float width);
+
+private:
+    QVector<float> m_lo;
+    QVector<float> m_hi;
+    QVector<int> m_top;
+    QVector<int> m_bottom;
+};
+
+#endif // LINERASTERIZER_H
@@ -6,7 +6,8 @@
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    m_framePool(4000, 8)
 {
     ui->setupUi(this);
 
@@ -16,7 +17,6 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->graphWidget->setHeaderText("Graph Title");
     ui->graphWidget->setFooterText("This is a footer.");
 
-    m_data.resize(4000);
     newData();
 
     m_timer = new QTimer(this);
@@ -31,7 +31,12 @@ MainWindow::~MainWindow()
 
 void MainWindow::newData()
 {
-    float *data = (float *)m_data.constData();
+    //Frames are recycled once the graph is done with them
+    SampleFrame frame = m_framePool.acquire();
+    if(frame.isNull())
+        return;
+
+    float *data = frame.data();
 
     for(int i = 0; i < 4000; i++)
     {
@@ -44,7 +49,7 @@ void MainWindow::newData()
         //data[i] *= 10;
     }
 
-    ui->graphWidget->setData(m_data);
+    ui->graphWidget->setData(frame);
 }
 
 void MainWindow::on_LeftAxisButton_toggled()
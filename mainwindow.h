@@ -3,6 +3,7 @@
 
 #include <QMainWindow>
 #include <QVector>
+#include "framepool.h"
 
 namespace Ui {
 class MainWindow;
@@ -37,7 +38,7 @@ protected slots:
 
 private:
     Ui::MainWindow *ui;
-    QVector<float> m_data;
+    FramePool m_framePool;
 
     QTimer *m_timer;
 };
@@ -0,0 +1,313 @@
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QUdpSocket>
+#include <QLocalSocket>
+#include <QByteArray>
+#include <stdio.h>
+#include <string.h>
+#include "glgraphwidget.h"
+#include "socketdatasource.h"
+#include "sharedmemorydatasource.h"
+#include "graphdataprotocol.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+//Stand-in for the processes that feed the graph. Sends frames over UDP, a
+//local socket and a shared memory ring to data sources in this process and
+//checks what their counters make of them:
+//
+//  graphproducer [-platform offscreen]
+//
+//The graph is never shown and uses the raster backend, so no GL is needed.
+//Exits with 1 if any check failed.
+
+#define SAMPLES 256
+#define HISTORY_LENGTH (64 * SAMPLES)
+#define RING_SLOTS 4
+#define WAIT_TIMEOUT_MS 2000
+
+namespace
+{
+    int s_failed = 0;
+
+    void check(const char *name, bool passed, const GraphDataSource &source)
+    {
+        printf("%s %s (received %llu, dropped %llu, lost %llu)\n", passed ? "ok    " : "FAILED", name,
+               (unsigned long long)source.receivedFrames(),
+               (unsigned long long)source.droppedFrames(),
+               (unsigned long long)source.lostFrames());
+
+        if(!passed)
+            s_failed++;
+    }
+
+    //Runs the event loop until the condition holds, false on a timeout
+    template <typename Condition>
+    bool waitFor(Condition condition)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        while(!condition())
+        {
+            if(timer.elapsed() > WAIT_TIMEOUT_MS)
+                return false;
+
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+
+        return true;
+    }
+
+    //Lets anything still in flight arrive before a counter is checked for
+    //not having changed
+    void settle()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        while(timer.elapsed() < 100)
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+
+    void appendFrame(QByteArray &data, quint32 sequence, quint32 magic = GRAPH_FRAME_MAGIC)
+    {
+        GraphFrameHeader header;
+        header.magic = magic;
+        header.sequence = sequence;
+        header.count = SAMPLES;
+        header.reserved = 0;
+        data.append((const char *)&header, sizeof(header));
+
+        float samples[SAMPLES];
+        for(int i = 0; i < SAMPLES; i++)
+            samples[i] = (float)sequence + ((float)i / SAMPLES);
+
+        data.append((const char *)samples, sizeof(samples));
+    }
+
+    void runUdp(GlGraphWidget *graph)
+    {
+        SocketDataSource source(graph);
+        if(!source.listenUdp(0))
+        {
+            fprintf(stderr, "FAILED udp listen: %s\n", source.errorString().toLocal8Bit().constData());
+            s_failed++;
+            return;
+        }
+
+        QUdpSocket sender;
+        quint16 port = source.udpPort();
+        graph->setHistoryLength(0);
+
+        //Three frames in one datagram are one batch, only the newest is shown
+        QByteArray datagram;
+        appendFrame(datagram, 0);
+        appendFrame(datagram, 1);
+        appendFrame(datagram, 2);
+        sender.writeDatagram(datagram, QHostAddress::LocalHost, port);
+        bool arrived = waitFor([&]() { return source.receivedFrames() >= 3; });
+        check("udp batch without history", arrived && source.receivedFrames() == 3 &&
+              source.droppedFrames() == 2 && source.lostFrames() == 0, source);
+
+        //Sequences 3 and 4 never sent
+        datagram.clear();
+        appendFrame(datagram, 5);
+        sender.writeDatagram(datagram, QHostAddress::LocalHost, port);
+        arrived = waitFor([&]() { return source.receivedFrames() >= 4; });
+        check("udp sequence gap", arrived && source.receivedFrames() == 4 &&
+              source.droppedFrames() == 2 && source.lostFrames() == 2, source);
+
+        //A whole frame followed by half a header is malformed as a whole
+        datagram.clear();
+        appendFrame(datagram, 6);
+        GraphFrameHeader trailing = { GRAPH_FRAME_MAGIC, 7, SAMPLES, 0 };
+        datagram.append((const char *)&trailing, sizeof(trailing) / 2);
+        sender.writeDatagram(datagram, QHostAddress::LocalHost, port);
+        settle();
+        check("udp trailing bytes", source.receivedFrames() == 4 && !source.errorString().isEmpty(), source);
+
+        //With a history every frame of the batch is kept
+        graph->setHistoryLength(HISTORY_LENGTH);
+        datagram.clear();
+        appendFrame(datagram, 6);
+        appendFrame(datagram, 7);
+        sender.writeDatagram(datagram, QHostAddress::LocalHost, port);
+        arrived = waitFor([&]() { return source.receivedFrames() >= 6; });
+        check("udp batch with history", arrived && source.receivedFrames() == 6 &&
+              source.droppedFrames() == 2 && source.lostFrames() == 2, source);
+
+        //The spectrum is taken over the continuous signal, so a burst has to
+        //reach the analyzer whole even without a history
+        graph->setHistoryLength(0);
+        graph->setDisplayMode(GlGraphWidget::SpectrumMode);
+        datagram.clear();
+        for(quint32 sequence = 8; sequence < 13; sequence++)
+            appendFrame(datagram, sequence);
+        sender.writeDatagram(datagram, QHostAddress::LocalHost, port);
+        arrived = waitFor([&]() { return source.receivedFrames() >= 11; });
+        check("udp burst in spectrum mode", arrived && source.receivedFrames() == 11 &&
+              source.droppedFrames() == 2 && source.lostFrames() == 2, source);
+
+        graph->setDisplayMode(GlGraphWidget::LineMode);
+    }
+
+    void runLocal(GlGraphWidget *graph)
+    {
+        QString name = QString("graphproducer-%1").arg(QCoreApplication::applicationPid());
+
+        SocketDataSource source(graph);
+        if(!source.listenLocal(name))
+        {
+            fprintf(stderr, "FAILED local listen: %s\n", source.errorString().toLocal8Bit().constData());
+            s_failed++;
+            return;
+        }
+
+        graph->setHistoryLength(0);
+
+        QLocalSocket client;
+        client.connectToServer(name);
+        if(!client.waitForConnected(WAIT_TIMEOUT_MS))
+        {
+            fprintf(stderr, "FAILED local connect: %s\n", client.errorString().toLocal8Bit().constData());
+            s_failed++;
+            return;
+        }
+
+        //The stream may be read in several pieces, so not every older frame
+        //has to be dropped
+        QByteArray data;
+        appendFrame(data, 0);
+        appendFrame(data, 1);
+        appendFrame(data, 2);
+        client.write(data);
+        client.waitForBytesWritten(WAIT_TIMEOUT_MS);
+        bool arrived = waitFor([&]() { return source.receivedFrames() >= 3; });
+        check("local stream", arrived && source.receivedFrames() == 3 &&
+              source.droppedFrames() <= 2 && source.lostFrames() == 0, source);
+
+        //A frame split across two writes is put back together
+        data.clear();
+        appendFrame(data, 3);
+        int split = sizeof(GraphFrameHeader) + 10;
+        client.write(data.constData(), split);
+        client.waitForBytesWritten(WAIT_TIMEOUT_MS);
+        settle();
+        bool partial = source.receivedFrames() == 3;
+        client.write(data.constData() + split, data.size() - split);
+        client.waitForBytesWritten(WAIT_TIMEOUT_MS);
+        arrived = waitFor([&]() { return source.receivedFrames() >= 4; });
+        check("local split frame", partial && arrived && source.receivedFrames() == 4 &&
+              source.lostFrames() == 0, source);
+
+        //There is no resynchronizing a corrupt stream, the connection goes
+        data.clear();
+        appendFrame(data, 4, 0);
+        client.write(data);
+        client.waitForBytesWritten(WAIT_TIMEOUT_MS);
+        bool dropped = waitFor([&]() { return client.state() == QLocalSocket::UnconnectedState; });
+        check("local bad magic", dropped && source.receivedFrames() == 4 &&
+              !source.errorString().isEmpty(), source);
+    }
+
+    void runSharedMemory(GlGraphWidget *graph)
+    {
+#ifdef Q_OS_UNIX
+        QByteArray name = QString("/graphproducer-%1").arg(QCoreApplication::applicationPid()).toLocal8Bit();
+        size_t size = GraphRingSize(RING_SLOTS, SAMPLES);
+
+        int fd = shm_open(name.constData(), O_CREAT | O_RDWR, 0600);
+        if(fd < 0 || ftruncate(fd, size) < 0)
+        {
+            fprintf(stderr, "FAILED shm_open %s\n", strerror(errno));
+            s_failed++;
+            if(fd >= 0)
+                ::close(fd);
+            shm_unlink(name.constData());
+            return;
+        }
+
+        void *mapping = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED)
+        {
+            fprintf(stderr, "FAILED mmap %s\n", strerror(errno));
+            s_failed++;
+            shm_unlink(name.constData());
+            return;
+        }
+
+        GraphRingHeader *ring = (GraphRingHeader *)mapping;
+        ring->magic = GRAPH_RING_MAGIC;
+        ring->slotCount = RING_SLOTS;
+        ring->slotCapacity = SAMPLES;
+        ring->reserved = 0;
+        ring->writeCount.storeRelease(0);
+
+        float samples[SAMPLES];
+        for(int i = 0; i < SAMPLES; i++)
+            samples[i] = (float)i / SAMPLES;
+
+        graph->setHistoryLength(0);
+
+        SharedMemoryDataSource source(graph);
+        source.setPollInterval(1);
+        if(!source.open(QString::fromLocal8Bit(name)))
+        {
+            fprintf(stderr, "FAILED shm open: %s\n", source.errorString().toLocal8Bit().constData());
+            s_failed++;
+        }
+        else
+        {
+            //Written between two polls, so read as one batch
+            for(int i = 0; i < 3; i++)
+                GraphRingWrite(ring, samples, SAMPLES);
+
+            bool arrived = waitFor([&]() { return source.receivedFrames() >= 3; });
+            check("ring batch without history", arrived && source.receivedFrames() == 3 &&
+                  source.droppedFrames() == 2 && source.lostFrames() == 0, source);
+
+            //Seven frames into four slots, the first three are overwritten
+            //before the reader gets to them
+            graph->setHistoryLength(HISTORY_LENGTH);
+            for(int i = 0; i < 7; i++)
+                GraphRingWrite(ring, samples, SAMPLES);
+
+            arrived = waitFor([&]() { return source.receivedFrames() >= 7; });
+            check("ring overrun with history", arrived && source.receivedFrames() == 7 &&
+                  source.droppedFrames() == 2 && source.lostFrames() == 3, source);
+
+            source.close();
+            graph->setHistoryLength(0);
+        }
+
+        munmap(mapping, size);
+        shm_unlink(name.constData());
+#else
+        Q_UNUSED(graph);
+        printf("skipped shared memory ring, Unix only\n");
+#endif
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    GlGraphWidget graph;
+    graph.setRenderBackend(GlGraphWidget::RasterBackend);
+    graph.setXAxisLimits(0, SAMPLES);
+
+    runUdp(&graph);
+    runLocal(&graph);
+    runSharedMemory(&graph);
+
+    printf("%d check(s) failed\n", s_failed);
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+#-------------------------------------------------
+#
+# Stand-in producer for SocketDataSource and SharedMemoryDataSource. Feeds
+# each transport to a source in the same process and checks its counters.
+# Built on its own: qmake producer/graphproducer.pro && make
+#
+#-------------------------------------------------
+
+QT       += core gui opengl widgets concurrent network
+
+TARGET = graphproducer
+TEMPLATE = app
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += graphproducer.cpp \
+        ../glgraphwidget.cpp \
+        ../glgraphresources.cpp \
+        ../glgraphrenderthread.cpp \
+        ../glgraphsurface.cpp \
+        ../graphkernels.cpp \
+        ../densitymap.cpp \
+        ../fftplan.cpp \
+        ../spectrumanalyzer.cpp \
+        ../qualitycontroller.cpp \
+        ../framepool.cpp \
+        ../samplehistory.cpp \
+        ../linerasterizer.cpp \
+        ../alarmindex.cpp \
+        ../graphdatasource.cpp \
+        ../socketdatasource.cpp \
+        ../sharedmemorydatasource.cpp
+
+HEADERS  += ../glgraphwidget.h \
+         ../glgraphresources.h \
+         ../glgraphrenderthread.h \
+         ../glgraphsurface.h \
+         ../graphkernels.h \
+         ../densitymap.h \
+         ../fftplan.h \
+         ../spectrumanalyzer.h \
+         ../qualitycontroller.h \
+         ../triplebuffer.h \
+         ../framepool.h \
+         ../samplehistory.h \
+         ../linerasterizer.h \
+         ../alarmindex.h \
+         ../graphdataprotocol.h \
+         ../graphdatasource.h \
+         ../socketdatasource.h \
+         ../sharedmemorydatasource.h
+
+unix:!macx: LIBS += -lrt
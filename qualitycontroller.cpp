@@ -0,0 +1,110 @@
+#include "qualitycontroller.h"
+
+#define FRAME_TIME_SMOOTHING 0.2
+
+QualityController::Policy::Policy()
+    : enabled(false)
+    , frameBudget(16)
+    , recoverRatio(0.5)
+    , degradeFrames(3)
+    , recoverFrames(60)
+    , worstLevel(Minimal)
+{
+}
+
+bool QualityController::Policy::operator==(const Policy &other) const
+{
+    return enabled == other.enabled &&
+           frameBudget == other.frameBudget &&
+           recoverRatio == other.recoverRatio &&
+           degradeFrames == other.degradeFrames &&
+           recoverFrames == other.recoverFrames &&
+           worstLevel == other.worstLevel;
+}
+
+QualityController::QualityController()
+    : m_level(FullQuality)
+    , m_fAverageFrameTime(0)
+    , m_iSlowFrames(0)
+    , m_iFastFrames(0)
+{
+}
+
+void QualityController::setPolicy(const Policy &policy)
+{
+    m_policy = policy;
+
+    if(!m_policy.enabled)
+        m_level = FullQuality;
+    else if(m_level > m_policy.worstLevel)
+        m_level = m_policy.worstLevel;
+
+    m_iSlowFrames = 0;
+    m_iFastFrames = 0;
+}
+
+const QualityController::Policy &QualityController::policy() const
+{
+    return m_policy;
+}
+
+bool QualityController::frameFinished(float frameTime)
+{
+    if(m_fAverageFrameTime == 0)
+        m_fAverageFrameTime = frameTime;
+    else
+        m_fAverageFrameTime += FRAME_TIME_SMOOTHING * (frameTime - m_fAverageFrameTime);
+
+    if(!m_policy.enabled)
+        return false;
+
+    if(m_fAverageFrameTime > m_policy.frameBudget)
+    {
+        m_iSlowFrames++;
+        m_iFastFrames = 0;
+    }
+    else if(m_fAverageFrameTime < m_policy.frameBudget * m_policy.recoverRatio)
+    {
+        m_iFastFrames++;
+        m_iSlowFrames = 0;
+    }
+    else
+    {
+        m_iSlowFrames = 0;
+        m_iFastFrames = 0;
+    }
+
+    Level level = m_level;
+    if(m_iSlowFrames >= m_policy.degradeFrames && m_level < m_policy.worstLevel)
+        level = (Level)(m_level + 1);
+    else if(m_iFastFrames >= m_policy.recoverFrames && m_level > FullQuality)
+        level = (Level)(m_level - 1);
+
+    if(level == m_level)
+        return false;
+
+    //Give the new level a full window before judging it
+    m_level = level;
+    m_fAverageFrameTime = 0;
+    m_iSlowFrames = 0;
+    m_iFastFrames = 0;
+    return true;
+}
+
+void QualityController::reset()
+{
+    m_level = FullQuality;
+    m_fAverageFrameTime = 0;
+    m_iSlowFrames = 0;
+    m_iFastFrames = 0;
+}
+
+QualityController::Level QualityController::level() const
+{
+    return m_level;
+}
+
+float QualityController::averageFrameTime() const
+{
+    return m_fAverageFrameTime;
+}
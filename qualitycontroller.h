@@ -0,0 +1,53 @@
+#ifndef QUALITYCONTROLLER_H
+#define QUALITYCONTROLLER_H
+
+//Picks a rendering quality level from measured frame times. Quality is
+//stepped down when the smoothed frame time stays over budget and stepped back
+//up once there has been plenty of headroom for a while.
+class QualityController
+{
+public:
+    //Each level includes the reductions of the levels before it
+    enum Level
+    {
+        FullQuality,
+        NoMultisample,  //MSAA disabled
+        Decimated,      //Lines reduced to a min/max pair per pixel column
+        Minimal         //Half grid density, axis labels re-laid out less often
+    };
+
+    struct Policy
+    {
+        Policy();
+
+        bool enabled;
+        float frameBudget;     //ms
+        float recoverRatio;    //Step up when below frameBudget * recoverRatio
+        int degradeFrames;     //Consecutive slow frames before stepping down
+        int recoverFrames;     //Consecutive fast frames before stepping up
+        Level worstLevel;      //Never degrade past this level
+
+        bool operator==(const Policy &other) const;
+    };
+
+    QualityController();
+
+    void setPolicy(const Policy &policy);
+    const Policy &policy() const;
+
+    //Returns true if the level changed
+    bool frameFinished(float frameTime);
+    void reset();
+
+    Level level() const;
+    float averageFrameTime() const;
+
+private:
+    Policy m_policy;
+    Level m_level;
+    float m_fAverageFrameTime;
+    int m_iSlowFrames;
+    int m_iFastFrames;
+};
+
+#endif // QUALITYCONTROLLER_H
@@ -0,0 +1,335 @@
+#include "samplehistory.h"
+#include "graphkernels.h"
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrentRun>
+#include <string.h>
+
+#define BLOCK_SIZE 256
+#define MIN_SAMPLES_PER_THREAD 65536
+
+static inline unsigned int FloatBits(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float BitsFloat(unsigned int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//Maps float bits onto unsigned integers that sort like the floats, so nearby
+//values of either sign have a small difference
+static inline unsigned int OrderedBits(unsigned int bits)
+{
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static inline unsigned int UnorderedBits(unsigned int ordered)
+{
+    return (ordered & 0x80000000u) ? (ordered & 0x7fffffffu) : ~ordered;
+}
+
+static inline unsigned int ZigZag(unsigned int delta)
+{
+    return (delta << 1) ^ (0u - (delta >> 31));
+}
+
+static inline unsigned int UnZigZag(unsigned int value)
+{
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+static inline int BitWidth(unsigned int value)
+{
+    int width = 0;
+    while(value)
+    {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+static inline int TrailingZeros(unsigned int value)
+{
+    int zeros = 0;
+    while(value && !(value & 1))
+    {
+        zeros++;
+        value >>= 1;
+    }
+    return zeros;
+}
+
+SampleHistory::SampleHistory()
+    : m_iCapacity(0)
+    , m_iFirstBlock(0)
+    , m_iBlockCount(0)
+    , m_iOpenCount(0)
+{
+}
+
+void SampleHistory::setCapacity(int samples)
+{
+    m_iCapacity = qMax(0, samples);
+
+    //Enough encoded blocks for the capacity plus the one being dropped
+    int blocks = (m_iCapacity > 0) ? ((m_iCapacity + BLOCK_SIZE - 1) / BLOCK_SIZE) + 1 : 0;
+    m_blocks.resize(blocks);
+    m_open.resize(m_iCapacity > 0 ? BLOCK_SIZE : 0);
+
+    clear();
+}
+
+int SampleHistory::capacity() const
+{
+    return m_iCapacity;
+}
+
+void SampleHistory::clear()
+{
+    //Block storage is kept, it is reused as the ring wraps
+    m_iFirstBlock = 0;
+    m_iBlockCount = 0;
+    m_iOpenCount = 0;
+}
+
+void SampleHistory::append(const float *data, int count)
+{
+    if(m_iCapacity == 0)
+        return;
+
+    while(count > 0)
+    {
+        int n = qMin(count, BLOCK_SIZE - m_iOpenCount);
+        memcpy(m_open.data() + m_iOpenCount, data, n * sizeof(float));
+        m_iOpenCount += n;
+        data += n;
+        count -= n;
+
+        if(m_iOpenCount < BLOCK_SIZE)
+            break;
+
+        if(m_iBlockCount == m_blocks.size())
+            dropOldest();
+
+        Block &block = m_blocks[(m_iFirstBlock + m_iBlockCount) % m_blocks.size()];
+        encodeBlock(block, m_open.constData(), BLOCK_SIZE);
+        m_iBlockCount++;
+        m_iOpenCount = 0;
+
+        while(m_iBlockCount > 0 && size() - BLOCK_SIZE >= m_iCapacity)
+            dropOldest();
+    }
+}
+
+void SampleHistory::dropOldest()
+{
+    m_iFirstBlock = (m_iFirstBlock + 1) % m_blocks.size();
+    m_iBlockCount--;
+}
+
+int SampleHistory::size() const
+{
+    return (m_iBlockCount * BLOCK_SIZE) + m_iOpenCount;
+}
+
+int SampleHistory::blockSize() const
+{
+    return BLOCK_SIZE;
+}
+
+int SampleHistory::blockCount() const
+{
+    return m_iBlockCount + ((m_iOpenCount > 0) ? 1 : 0);
+}
+
+const SampleHistory::Block &SampleHistory::block(int index) const
+{
+    return m_blocks[(m_iFirstBlock + index) % m_blocks.size()];
+}
+
+void SampleHistory::extents(float &min, float &max) const
+{
+    min = 0;
+    max = 0;
+
+    if(m_iOpenCount > 0)
+        FindExtents(m_open.constData(), m_iOpenCount, min, max);
+    else if(m_iBlockCount > 0)
+        min = max = block(0).min;
+
+    for(int i = 0; i < m_iBlockCount; i++)
+    {
+        min = qMin(min, block(i).min);
+        max = qMax(max, block(i).max);
+    }
+}
+
+void SampleHistory::blockExtents(int first, int count, float *out) const
+{
+    for(int i = first; i < first + count; i++, out += 2)
+    {
+        if(i < m_iBlockCount)
+        {
+            out[0] = block(i).min;
+            out[1] = block(i).max;
+        }
+        else
+        {
+            FindExtents(m_open.constData(), m_iOpenCount, out[0], out[1]);
+        }
+    }
+}
+
+int SampleHistory::decode(int first, int count, float *out) const
+{
+    first = qBound(0, first, blockCount());
+    count = qBound(0, count, blockCount() - first);
+
+    //The open block is raw, everything before it is split across threads
+    int encoded = qMax(0, qMin(count, m_iBlockCount - first));
+    int threads = qBound(1, (encoded * BLOCK_SIZE) / MIN_SAMPLES_PER_THREAD, QThread::idealThreadCount());
+    int chunkSize = (encoded + threads - 1) / qMax(1, threads);
+
+    QVector<QFuture<void> > futures;
+    for(int start = chunkSize; start < encoded; start += chunkSize)
+    {
+        futures.append(QtConcurrent::run(&SampleHistory::decodeBlocks, this, first + start,
+                                         qMin(chunkSize, encoded - start), out + (start * BLOCK_SIZE)));
+    }
+
+    decodeBlocks(this, first, qMin(chunkSize, encoded), out);
+
+    for(int i = 0; i < futures.size(); i++)
+        futures[i].waitForFinished();
+
+    int samples = encoded * BLOCK_SIZE;
+    if(count > encoded)
+    {
+        memcpy(out + samples, m_open.constData(), m_iOpenCount * sizeof(float));
+        samples += m_iOpenCount;
+    }
+
+    return samples;
+}
+
+void SampleHistory::decodeBlocks(const SampleHistory *history, int first, int count, float *out)
+{
+    for(int i = 0; i < count; i++, out += BLOCK_SIZE)
+        decodeBlock(history->block(first + i), out);
+}
+
+int SampleHistory::memoryUsage() const
+{
+    int bytes = m_open.size() * sizeof(float);
+    for(int i = 0; i < m_iBlockCount; i++)
+        bytes += sizeof(Block) + (block(i).words.size() * sizeof(unsigned int));
+
+    return bytes;
+}
+
+void SampleHistory::encodeBlock(Block &block, const float *data, int count)
+{
+    FindExtents(data, count, block.min, block.max);
+    block.count = count;
+    block.first = FloatBits(data[0]);
+
+    //Measure both encodings, smooth data packs better as deltas while
+    //repeated or coarsely quantized values leave long XOR zero runs
+    unsigned int xorBits = 0;
+    unsigned int deltaBits = 0;
+    unsigned int previous = block.first;
+    unsigned int previousOrdered = OrderedBits(previous);
+    for(int i = 1; i < count; i++)
+    {
+        unsigned int bits = FloatBits(data[i]);
+        unsigned int ordered = OrderedBits(bits);
+        xorBits |= bits ^ previous;
+        deltaBits |= ZigZag(ordered - previousOrdered);
+        previous = bits;
+        previousOrdered = ordered;
+    }
+
+    int shift = TrailingZeros(xorBits);
+    int xorWidth = BitWidth(xorBits >> shift);
+    int deltaWidth = BitWidth(deltaBits);
+
+    block.delta = deltaWidth < xorWidth;
+    block.shift = block.delta ? 0 : shift;
+    block.width = block.delta ? deltaWidth : xorWidth;
+    block.words.resize((((count - 1) * block.width) + 31) / 32);
+
+    //Pack the values LSB first through a 64 bit accumulator
+    unsigned int *out = block.words.data();
+    unsigned long long accumulator = 0;
+    int bitCount = 0;
+    previous = block.first;
+    previousOrdered = OrderedBits(previous);
+    for(int i = 1; i < count && block.width > 0; i++)
+    {
+        unsigned int bits = FloatBits(data[i]);
+        unsigned int ordered = OrderedBits(bits);
+        unsigned int value = block.delta ? ZigZag(ordered - previousOrdered) : ((bits ^ previous) >> block.shift);
+        previous = bits;
+        previousOrdered = ordered;
+
+        accumulator |= (unsigned long long)value << bitCount;
+        bitCount += block.width;
+        if(bitCount >= 32)
+        {
+            *out++ = (unsigned int)accumulator;
+            accumulator >>= 32;
+            bitCount -= 32;
+        }
+    }
+
+    if(bitCount > 0)
+        *out = (unsigned int)accumulator;
+}
+
+void SampleHistory::decodeBlock(const Block &block, float *out)
+{
+    const unsigned int *in = block.words.constData();
+    unsigned int mask = (block.width == 32) ? 0xffffffffu : ((1u << block.width) - 1);
+    unsigned long long accumulator = 0;
+    int bitCount = 0;
+
+    unsigned int bits = block.first;
+    unsigned int ordered = OrderedBits(bits);
+    out[0] = BitsFloat(bits);
+
+    for(int i = 1; i < block.count; i++)
+    {
+        unsigned int value = 0;
+        if(block.width > 0)
+        {
+            if(bitCount < block.width)
+            {
+                accumulator |= (unsigned long long)*in++ << bitCount;
+                bitCount += 32;
+            }
+
+            value = (unsigned int)accumulator & mask;
+            accumulator >>= block.width;
+            bitCount -= block.width;
+        }
+
+        if(block.delta)
+        {
+            ordered += UnZigZag(value);
+            bits = UnorderedBits(ordered);
+        }
+        else
+        {
+            bits ^= value << block.shift;
+        }
+
+        out[i] = BitsFloat(bits);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef SAMPLEHISTORY_H
+#define SAMPLEHISTORY_H
+
+#include <QVector>
+
+//Rolling history of samples kept losslessly compressed in fixed size blocks.
+//Each block stores the XOR or the delta of consecutive sample bits, whichever
+//packs tighter, bit-packed to the widest value in the block. The min/max of
+//every block is kept uncompressed, so zoomed out views can be drawn from the
+//headers alone and only the visible blocks ever need decoding.
+class SampleHistory
+{
+public:
+    SampleHistory();
+
+    //Number of samples to retain, 0 disables the history. Clears it.
+    void setCapacity(int samples);
+    int capacity() const;
+    void clear();
+
+    //Oldest blocks are dropped once the capacity is exceeded
+    void append(const float *data, int count);
+
+    int size() const;
+    int blockSize() const;
+    //Block 0 is the oldest. Every block but the newest holds blockSize() samples.
+    int blockCount() const;
+
+    //Limits of the whole history, from the block headers
+    void extents(float &min, float &max) const;
+    //Writes a min, max pair per block to out, which must hold 2 * count values
+    void blockExtents(int first, int count, float *out) const;
+    //Decodes count blocks starting at first, in parallel when there are many.
+    //out must hold count * blockSize() values, returns the number of samples.
+    int decode(int first, int count, float *out) const;
+
+    //Bytes used by the encoded blocks
+    int memoryUsage() const;
+
+private:
+    struct Block
+    {
+        float min;
+        float max;
+        unsigned int first;     //Raw bits of the first sample
+        int count;
+        int width;              //Bits per packed value
+        int shift;              //XOR values are stored without their common trailing zeros
+        bool delta;             //Zigzag delta of order preserving bits instead of XOR
+        QVector<unsigned int> words;
+    };
+
+    const Block &block(int index) const;
+    void dropOldest();
+    static void encodeBlock(Block &block, const float *data, int count);
+    static void decodeBlock(const Block &block, float *out);
+    static void decodeBlocks(const SampleHistory *history, int first, int count, float *out);
+
+    int m_iCapacity;
+    QVector<Block> m_blocks;    //Ring of encoded blocks
+    int m_iFirstBlock;
+    int m_iBlockCount;
+    QVector<float> m_open;      //Newest block, raw until it fills up
+    int m_iOpenCount;
+};
+
+#endif // SAMPLEHISTORY_H
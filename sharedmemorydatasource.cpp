@@ -0,0 +1,189 @@
+#include "sharedmemorydatasource.h"
+#include "graphdataprotocol.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include <atomic>
+
+#define DEFAULT_POLL_INTERVAL 5
+
+SharedMemoryDataSource::SharedMemoryDataSource(GlGraphWidget *graph, QObject *parent)
+    : GraphDataSource(graph, parent)
+    , m_ring(0)
+    , m_iMappedSize(0)
+    , m_iSlotCount(0)
+    , m_iSlotCapacity(0)
+    , m_iReadCount(0)
+{
+    m_pollTimer.setInterval(DEFAULT_POLL_INTERVAL);
+    connect(&m_pollTimer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+SharedMemoryDataSource::~SharedMemoryDataSource()
+{
+    close();
+}
+
+bool SharedMemoryDataSource::open(const QString &name)
+{
+    close();
+
+#ifdef Q_OS_UNIX
+    int fd = shm_open(name.toLocal8Bit().constData(), O_RDONLY, 0);
+    if(fd < 0)
+    {
+        setErrorString(QString("shm_open: %1").arg(strerror(errno)));
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(GraphRingHeader))
+    {
+        setErrorString("Shared memory is too small for a ring header");
+        ::close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        setErrorString(QString("mmap: %1").arg(strerror(errno)));
+        return false;
+    }
+
+    //The producer can still write the header, so its geometry is read once,
+    //checked and never read again
+    const GraphRingHeader *ring = (const GraphRingHeader *)mapping;
+    quint32 slotCount = ring->slotCount;
+    quint32 slotCapacity = ring->slotCapacity;
+    bool valid = ring->magic == GRAPH_RING_MAGIC && slotCount > 0 &&
+                 (slotCount & (slotCount - 1)) == 0 &&
+                 slotCount <= (size_t)info.st_size / sizeof(GraphRingSlot) &&
+                 slotCapacity <= GRAPH_FRAME_MAX_SAMPLES &&
+                 GraphRingSize(slotCount, slotCapacity) <= (size_t)info.st_size;
+    if(!valid)
+    {
+        setErrorString("Shared memory does not hold a graph ring");
+        munmap(mapping, info.st_size);
+        return false;
+    }
+
+    m_ring = ring;
+    m_iMappedSize = info.st_size;
+    m_iSlotCount = slotCount;
+    m_iSlotCapacity = slotCapacity;
+
+    //Only frames written from now on are shown
+    m_iReadCount = m_ring->writeCount.loadAcquire();
+    m_pollTimer.start();
+    return true;
+#else
+    Q_UNUSED(name);
+    setErrorString("Shared memory rings are only supported on Unix");
+    return false;
+#endif
+}
+
+void SharedMemoryDataSource::close()
+{
+    m_pollTimer.stop();
+
+#ifdef Q_OS_UNIX
+    if(m_ring)
+        munmap((void *)m_ring, m_iMappedSize);
+#endif
+
+    m_ring = 0;
+    m_iMappedSize = 0;
+    m_iSlotCount = 0;
+    m_iSlotCapacity = 0;
+}
+
+bool SharedMemoryDataSource::isOpen() const
+{
+    return m_ring != 0;
+}
+
+void SharedMemoryDataSource::setPollInterval(int ms)
+{
+    m_pollTimer.setInterval(ms);
+}
+
+int SharedMemoryDataSource::pollInterval() const
+{
+    return m_pollTimer.interval();
+}
+
+void SharedMemoryDataSource::poll()
+{
+    quint32 written = m_ring->writeCount.loadAcquire();
+    quint32 available = written - m_iReadCount;
+    if(available == 0)
+        return;
+
+    //Anything more than a ring behind has been overwritten already, the
+    //sequence gap counts it as lost
+    quint32 first = m_iReadCount;
+    if(available > m_iSlotCount)
+        first = written - m_iSlotCount;
+
+    //Without a history only the newest frame would ever be seen, the older
+    //ones are accounted for without being copied
+    if(!everyFrame())
+    {
+        quint32 skipped = 0;
+        for(quint32 frame = first; frame + 1 != written; frame++)
+        {
+            frameArrived(frame);
+            skipped++;
+        }
+
+        dropFrames(skipped);
+        first = written - 1;
+    }
+
+    for(quint32 frame = first; frame != written; frame++)
+    {
+        if(!ReadFrame(frame))
+            break;
+    }
+
+    m_iReadCount = written;
+}
+
+bool SharedMemoryDataSource::ReadFrame(quint32 frame)
+{
+    //Returns false if the producer has lapped the reader, every later frame
+    //in the batch is then being overwritten too
+    const GraphRingSlot *slot = GraphRingSlotAt(m_ring, m_iSlotCount, m_iSlotCapacity, frame);
+    int sequence = (frame * 2) + 2;
+    if(slot->sequence.loadAcquire() != sequence)
+        return false;
+
+    quint32 count = qMin(slot->count, m_iSlotCapacity);
+    SampleFrame data = acquireFrame(count);
+    if(data.isNull())
+    {
+        frameArrived(frame);
+        return true;
+    }
+
+    memcpy(data.data(), GraphRingSamples(slot), count * sizeof(float));
+
+    //The samples have to be read before the sequence is checked again. An
+    //acquire load does not order the reads before it, only a fence does.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot->sequence.loadAcquire() != sequence)
+        return false;
+
+    frameArrived(frame);
+    deliver(data);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef SHAREDMEMORYDATASOURCE_H
+#define SHAREDMEMORYDATASOURCE_H
+
+#include <QTimer>
+#include "graphdatasource.h"
+
+struct GraphRingHeader;
+
+//Reads frames out of a POSIX shared memory ring (see graphdataprotocol.h)
+//written by another process. The ring is mapped read only and polled, every
+//frame published since the last poll is handled as one batch. The producer
+//never waits on the reader: slots it overwrote before they were read count as
+//lost frames.
+class SharedMemoryDataSource : public GraphDataSource
+{
+    Q_OBJECT
+public:
+    explicit SharedMemoryDataSource(GlGraphWidget *graph, QObject *parent = 0);
+    ~SharedMemoryDataSource();
+
+    //The name as given to shm_open, e.g. "/graph"
+    bool open(const QString &name);
+    void close();
+    bool isOpen() const;
+
+    void setPollInterval(int ms);
+    int pollInterval() const;
+
+private slots:
+    void poll();
+
+private:
+    bool ReadFrame(quint32 frame);
+
+    const GraphRingHeader *m_ring;
+    size_t m_iMappedSize;
+    //Ring geometry as validated by open()
+    quint32 m_iSlotCount;
+    quint32 m_iSlotCapacity;
+    quint32 m_iReadCount;
+    QTimer m_pollTimer;
+};
+
+#endif // SHAREDMEMORYDATASOURCE_H
@@ -0,0 +1,226 @@
+#include "socketdatasource.h"
+#include "graphdataprotocol.h"
+#include <QUdpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <string.h>
+
+SocketDataSource::SocketDataSource(GlGraphWidget *graph, QObject *parent)
+    : GraphDataSource(graph, parent)
+    , m_udpSocket(0)
+    , m_localServer(0)
+    , m_localSocket(0)
+{
+}
+
+SocketDataSource::~SocketDataSource()
+{
+    close();
+}
+
+bool SocketDataSource::listenUdp(quint16 port, const QHostAddress &address)
+{
+    close();
+
+    m_udpSocket = new QUdpSocket(this);
+    if(!m_udpSocket->bind(address, port))
+    {
+        setErrorString(m_udpSocket->errorString());
+        close();
+        return false;
+    }
+
+    connect(m_udpSocket, SIGNAL(readyRead()), this, SLOT(readDatagrams()));
+    return true;
+}
+
+bool SocketDataSource::listenLocal(const QString &name)
+{
+    close();
+
+    //A previous run that crashed may have left the socket file behind
+    QLocalServer::removeServer(name);
+
+    m_localServer = new QLocalServer(this);
+    m_localServer->setMaxPendingConnections(1);
+    if(!m_localServer->listen(name))
+    {
+        setErrorString(m_localServer->errorString());
+        close();
+        return false;
+    }
+
+    connect(m_localServer, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    return true;
+}
+
+void SocketDataSource::close()
+{
+    delete m_udpSocket;
+    m_udpSocket = 0;
+
+    if(m_localSocket)
+    {
+        m_localSocket->disconnect(this);
+        m_localSocket->deleteLater();
+        m_localSocket = 0;
+    }
+
+    delete m_localServer;
+    m_localServer = 0;
+
+    m_buffer.resize(0);
+}
+
+bool SocketDataSource::isListening() const
+{
+    return m_udpSocket || m_localServer;
+}
+
+quint16 SocketDataSource::udpPort() const
+{
+    return m_udpSocket ? m_udpSocket->localPort() : 0;
+}
+
+void SocketDataSource::readDatagrams()
+{
+    m_frames.resize(0);
+    m_buffer.resize(0);
+
+    //Every datagram waiting is read into one buffer first. Frames never span
+    //datagrams, so each one is parsed on its own.
+    while(m_udpSocket->hasPendingDatagrams())
+    {
+        int offset = m_buffer.size();
+        int size = m_udpSocket->pendingDatagramSize();
+        m_buffer.resize(offset + qMax(0, size));
+
+        size = m_udpSocket->readDatagram(m_buffer.data() + offset, qMax(0, size));
+        if(size <= 0)
+        {
+            m_buffer.resize(offset);
+            continue;
+        }
+
+        //Frames never span datagrams, so a partial one at the end is as
+        //malformed as a bad header
+        int frames = m_frames.size();
+        if(ParseFrames(offset, size) != size)
+        {
+            m_frames.resize(frames);
+            setErrorString("Malformed datagram");
+        }
+    }
+
+    DeliverFrames();
+}
+
+void SocketDataSource::newConnection()
+{
+    QLocalSocket *socket = m_localServer->nextPendingConnection();
+    if(!socket)
+        return;
+
+    //One producer at a time, a new connection replaces the old one
+    if(m_localSocket)
+    {
+        m_localSocket->disconnect(this);
+        m_localSocket->deleteLater();
+    }
+
+    m_localSocket = socket;
+    m_buffer.resize(0);
+    connect(m_localSocket, SIGNAL(readyRead()), this, SLOT(readStream()));
+    connect(m_localSocket, SIGNAL(disconnected()), this, SLOT(streamDisconnected()));
+}
+
+void SocketDataSource::readStream()
+{
+    int offset = m_buffer.size();
+    qint64 available = m_localSocket->bytesAvailable();
+    if(available <= 0)
+        return;
+
+    m_buffer.resize(offset + available);
+    qint64 read = m_localSocket->read(m_buffer.data() + offset, available);
+    m_buffer.resize(offset + qMax((qint64)0, read));
+
+    m_frames.resize(0);
+    int used = ParseFrames(0, m_buffer.size());
+    if(used < 0)
+    {
+        //There is no way to find the next frame in a corrupt stream
+        setErrorString("Malformed frame, dropping the connection");
+        m_localSocket->abort();
+        m_buffer.resize(0);
+        return;
+    }
+
+    DeliverFrames();
+
+    //Keep the partial frame at the end for the next read
+    m_buffer.remove(0, used);
+}
+
+void SocketDataSource::streamDisconnected()
+{
+    m_localSocket->deleteLater();
+    m_localSocket = 0;
+    m_buffer.resize(0);
+}
+
+int SocketDataSource::ParseFrames(int offset, int size)
+{
+    //Records the frames in size bytes of m_buffer from offset, returns the
+    //bytes of complete frames or -1 if the data is not framed
+    const char *data = m_buffer.constData() + offset;
+    int used = 0;
+
+    while(size - used >= (int)sizeof(GraphFrameHeader))
+    {
+        GraphFrameHeader header;
+        memcpy(&header, data + used, sizeof(header));
+
+        if(header.magic != GRAPH_FRAME_MAGIC || header.count > GRAPH_FRAME_MAX_SAMPLES)
+            return -1;
+
+        int frameSize = sizeof(header) + (header.count * sizeof(float));
+        if(size - used < frameSize)
+            break;
+
+        PendingFrame frame;
+        frame.offset = offset + used + sizeof(header);
+        frame.sequence = header.sequence;
+        frame.count = header.count;
+        m_frames.append(frame);
+
+        used += frameSize;
+    }
+
+    return used;
+}
+
+void SocketDataSource::DeliverFrames()
+{
+    int first = 0;
+    for(int i = 0; i < m_frames.size(); i++)
+        frameArrived(m_frames[i].sequence);
+
+    //Without a history only the newest frame would ever be seen
+    if(!everyFrame() && m_frames.size() > 1)
+    {
+        first = m_frames.size() - 1;
+        dropFrames(first);
+    }
+
+    for(int i = first; i < m_frames.size(); i++)
+    {
+        SampleFrame frame = acquireFrame(m_frames[i].count);
+        if(frame.isNull())
+            continue;
+
+        //Samples are not necessarily aligned within the stream
+        memcpy(frame.data(), m_buffer.constData() + m_frames[i].offset, m_frames[i].count * sizeof(float));
+        deliver(frame);
+    }
+}
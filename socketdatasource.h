@@ -0,0 +1,59 @@
+#ifndef SOCKETDATASOURCE_H
+#define SOCKETDATASOURCE_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QHostAddress>
+#include "graphdatasource.h"
+
+class QUdpSocket;
+class QLocalServer;
+class QLocalSocket;
+
+//Receives GraphFrameHeader framed samples (see graphdataprotocol.h) over a
+//local UDP port or a local socket, a Unix domain socket on Unix. Everything
+//readable when the socket wakes up is handled as one batch.
+class SocketDataSource : public GraphDataSource
+{
+    Q_OBJECT
+public:
+    explicit SocketDataSource(GlGraphWidget *graph, QObject *parent = 0);
+    ~SocketDataSource();
+
+    //One or more frames per datagram
+    bool listenUdp(quint16 port, const QHostAddress &address = QHostAddress::LocalHost);
+    //Stream of frames from one producer at a time
+    bool listenLocal(const QString &name);
+    void close();
+    bool isListening() const;
+    //Port bound by listenUdp(), useful after asking for port 0
+    quint16 udpPort() const;
+
+private slots:
+    void readDatagrams();
+    void newConnection();
+    void readStream();
+    void streamDisconnected();
+
+private:
+    struct PendingFrame
+    {
+        int offset;             //Of the samples within m_buffer
+        quint32 sequence;
+        quint32 count;
+    };
+
+    int ParseFrames(int offset, int size);
+    void DeliverFrames();
+
+    QUdpSocket *m_udpSocket;
+    QLocalServer *m_localServer;
+    QLocalSocket *m_localSocket;
+
+    //Raw bytes of the current batch and the frames found in them, both
+    //kept between batches so they stop allocating once they are big enough
+    QByteArray m_buffer;
+    QVector<PendingFrame> m_frames;
+};
+
+#endif // SOCKETDATASOURCE_H
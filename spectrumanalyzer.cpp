@@ -0,0 +1,206 @@
+#include "spectrumanalyzer.h"
+#include <string.h>
+#include <qmath.h>
+
+#define MIN_FFT_SIZE 16
+#define MAX_OVERLAP 0.95
+#define MIN_POWER 1e-20f
+//Spectra the graph can hold at once plus a few queued to it
+#define SPECTRUM_POOL_SIZE 8
+
+SpectrumAnalyzer::Settings::Settings()
+    : fftSize(4096)
+    , window(HannWindow)
+    , overlap(0.5)
+    , averages(1)
+{
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent)
+    : QObject(parent)
+    , m_spectrumPool(0, SPECTRUM_POOL_SIZE)
+    , m_iFifoStart(0)
+    , m_iFifoEnd(0)
+    , m_iAveraged(0)
+    , m_fWindowGain(1)
+{
+    qRegisterMetaType<SpectrumAnalyzer::Settings>("SpectrumAnalyzer::Settings");
+    qRegisterMetaType<QVector<float> >("QVector<float>");
+    qRegisterMetaType<SampleFrame>("SampleFrame");
+
+    Settings settings;
+    m_settings.fftSize = 0;
+    setSettings(settings);
+}
+
+int SpectrumAnalyzer::pendingBlocks() const
+{
+    return m_pending.load();
+}
+
+void SpectrumAnalyzer::blockQueued()
+{
+    m_pending.ref();
+}
+
+void SpectrumAnalyzer::setSettings(const SpectrumAnalyzer::Settings &settings)
+{
+    Settings newSettings = settings;
+    if(newSettings.fftSize < MIN_FFT_SIZE || !FftPlan::isPowerOfTwo(newSettings.fftSize))
+        newSettings.fftSize = m_settings.fftSize;
+    newSettings.overlap = qBound((float)0, newSettings.overlap, (float)MAX_OVERLAP);
+    newSettings.averages = qMax(1, newSettings.averages);
+
+    bool resize = newSettings.fftSize != m_settings.fftSize;
+    bool rewindow = resize || newSettings.window != m_settings.window;
+    m_settings = newSettings;
+
+    if(resize)
+    {
+        int size = m_settings.fftSize;
+        m_plan.setSize(size);
+        m_re.resize(size);
+        m_im.resize(size);
+        m_power.resize((size / 2) + 1);
+        m_spectrumPool.ensureCapacity((size / 2) + 1);
+    }
+
+    if(rewindow)
+        createWindow();
+
+    reset();
+}
+
+void SpectrumAnalyzer::process(const SampleFrame &samples)
+{
+    m_pending.deref();
+    Process(samples.constData(), samples.size());
+}
+
+void SpectrumAnalyzer::process(const QVector<float> &samples)
+{
+    m_pending.deref();
+    Process(samples.constData(), samples.size());
+}
+
+void SpectrumAnalyzer::Process(const float *samples, int count)
+{
+
+    int size = m_settings.fftSize;
+    if(size == 0)
+        return;
+
+    //Keep the unconsumed tail at the front so the fifo only grows when a
+    //larger block than ever before arrives
+    int remaining = m_iFifoEnd - m_iFifoStart;
+    if(m_iFifoStart > 0)
+    {
+        memmove(m_fifo.data(), m_fifo.constData() + m_iFifoStart, remaining * sizeof(float));
+        m_iFifoStart = 0;
+        m_iFifoEnd = remaining;
+    }
+
+    if(m_fifo.size() < m_iFifoEnd + count)
+        m_fifo.resize(m_iFifoEnd + count);
+
+    if(count > 0)
+        memcpy(m_fifo.data() + m_iFifoEnd, samples, count * sizeof(float));
+    m_iFifoEnd += count;
+
+    int hop = qMax(1, (int)(size * (1.0 - m_settings.overlap)));
+    bool newSpectrum = false;
+
+    while(m_iFifoEnd - m_iFifoStart >= size)
+    {
+        processFrame(m_fifo.constData() + m_iFifoStart);
+        m_iFifoStart += hop;
+        newSpectrum = true;
+    }
+
+    if(!newSpectrum)
+        return;
+
+    //Only allocates if the graph is holding on to every pooled spectrum
+    SampleFrame spectrum = m_spectrumPool.acquire();
+    if(spectrum.isNull())
+        spectrum = SampleFrame(m_power.size());
+    spectrum.resize(m_power.size());
+
+    float *out = spectrum.data();
+    const float *power = m_power.constData();
+    for(int i = 0; i < m_power.size(); i++)
+        out[i] = 10.0 * log10(qMax(power[i], MIN_POWER));
+
+    emit spectrumReady(spectrum);
+}
+
+void SpectrumAnalyzer::reset()
+{
+    m_iFifoStart = 0;
+    m_iFifoEnd = 0;
+    m_iAveraged = 0;
+    m_power.fill(0);
+}
+
+void SpectrumAnalyzer::createWindow()
+{
+    int size = m_settings.fftSize;
+    m_window.resize(size);
+
+    float sum = 0;
+    for(int i = 0; i < size; i++)
+    {
+        double phase = (2.0 * M_PI * i) / (size - 1);
+        float value = 1.0;
+
+        switch(m_settings.window)
+        {
+        case HannWindow:
+            value = 0.5 - (0.5 * cos(phase));
+            break;
+        case HammingWindow:
+            value = 0.54 - (0.46 * cos(phase));
+            break;
+        case BlackmanWindow:
+            value = 0.42 - (0.5 * cos(phase)) + (0.08 * cos(2.0 * phase));
+            break;
+        case RectangularWindow:
+            break;
+        }
+
+        m_window[i] = value;
+        sum += value;
+    }
+
+    //Scales a full scale sine to 0 dB regardless of the window
+    m_fWindowGain = 2.0 / sum;
+}
+
+void SpectrumAnalyzer::processFrame(const float *frame)
+{
+    int size = m_settings.fftSize;
+    const float *window = m_window.constData();
+    float *re = m_re.data();
+    float *im = m_im.data();
+
+    for(int i = 0; i < size; i++)
+    {
+        re[i] = frame[i] * window[i];
+        im[i] = 0;
+    }
+
+    m_plan.transform(re, im);
+
+    //Running mean over the first frames, exponential average after that
+    if(m_iAveraged < m_settings.averages)
+        m_iAveraged++;
+    float alpha = 1.0 / m_iAveraged;
+
+    float *power = m_power.data();
+    float gain = m_fWindowGain * m_fWindowGain;
+    for(int i = 0; i < m_power.size(); i++)
+    {
+        float value = ((re[i] * re[i]) + (im[i] * im[i])) * gain;
+        power[i] += alpha * (value - power[i]);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QMetaType>
+#include "fftplan.h"
+#include "framepool.h"
+
+//Turns a stream of time domain samples into magnitude spectra in dB. Lives
+//on a worker thread; samples are queued to process() and results come back
+//through spectrumReady(). All buffers are sized when the settings change and
+//results are written straight into pooled frames, so steady state processing
+//neither allocates nor copies a result.
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    enum Window
+    {
+        RectangularWindow,
+        HannWindow,
+        HammingWindow,
+        BlackmanWindow
+    };
+
+    struct Settings
+    {
+        Settings();
+
+        int fftSize;
+        Window window;
+        float overlap;
+        int averages;
+    };
+
+    explicit SpectrumAnalyzer(QObject *parent = 0);
+
+    //Number of blocks queued to process() that have not been handled yet
+    int pendingBlocks() const;
+    void blockQueued();
+
+public slots:
+    void setSettings(const SpectrumAnalyzer::Settings &settings);
+    void process(const SampleFrame &samples);
+    void process(const QVector<float> &samples);
+    void reset();
+
+signals:
+    void spectrumReady(const SampleFrame &spectrum);
+
+private:
+    void Process(const float *samples, int count);
+    void createWindow();
+    void processFrame(const float *frame);
+
+    Settings m_settings;
+    FftPlan m_plan;
+
+    QVector<float> m_window;
+    QVector<float> m_re;
+    QVector<float> m_im;
+    QVector<float> m_power;
+    FramePool m_spectrumPool;
+    QVector<float> m_fifo;
+    int m_iFifoStart;
+    int m_iFifoEnd;
+    int m_iAveraged;
+    float m_fWindowGain;
+
+    QAtomicInt m_pending;
+};
+
+Q_DECLARE_METATYPE(SpectrumAnalyzer::Settings)
+
+#endif // SPECTRUMANALYZER_H
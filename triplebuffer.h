@@ -0,0 +1,59 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <QAtomicInt>
+
+//Lock free single producer, single consumer handoff of the latest value.
+//The producer fills writeBuffer() and calls publish(), the consumer calls
+//update() and reads readBuffer(). Neither side ever waits for the other;
+//values published faster than they are consumed are skipped.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : m_shared(1)
+        , m_iWrite(0)
+        , m_iRead(2)
+    {
+    }
+
+    T &writeBuffer()
+    {
+        return m_buffers[m_iWrite];
+    }
+
+    void publish()
+    {
+        m_iWrite = m_shared.fetchAndStoreOrdered(m_iWrite | FRESH) & INDEX_MASK;
+    }
+
+    //Returns true if a newer value than the current read buffer was published
+    bool update()
+    {
+        if(!(m_shared.load() & FRESH))
+            return false;
+
+        m_iRead = m_shared.fetchAndStoreOrdered(m_iRead) & INDEX_MASK;
+        return true;
+    }
+
+    const T &readBuffer() const
+    {
+        return m_buffers[m_iRead];
+    }
+
+private:
+    enum
+    {
+        INDEX_MASK = 3,
+        FRESH = 4
+    };
+
+    T m_buffers[3];
+    QAtomicInt m_shared;    //Index of the buffer between the two sides | FRESH
+    int m_iWrite;           //Only touched by the producer
+    int m_iRead;            //Only touched by the consumer
+};
+
+#endif // TRIPLEBUFFER_H